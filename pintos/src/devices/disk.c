@@ -3,10 +3,13 @@
 #include <debug.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -28,10 +31,25 @@
 #define reg_ctl(CHANNEL) ((CHANNEL)->reg_base + 0x206)  /* Control (w/o). */
 #define reg_alt_status(CHANNEL) reg_ctl (CHANNEL)       /* Alt Status (r/o). */
 
+/* Bus-master IDE registers, relative to a channel's bm_base.
+   See the Intel PIIX datasheet and [SFF-8038i]. */
+#define BM_COMMAND 0                    /* Command. */
+#define BM_STATUS 2                     /* Status. */
+#define BM_PRDT 4                       /* PRD table physical address. */
+
+/* Bus-master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start/stop transfer. */
+#define BM_CMD_WRITE 0x08       /* Transfer direction: 1=into memory. */
+
+/* Bus-master Status Register bits. */
+#define BM_STA_ERROR 0x02       /* Transfer failed (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Device interrupted (write 1 to clear). */
+
 /* Alternate Status Register bits. */
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -47,6 +65,30 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Physical Region Descriptor: one physically contiguous piece of
+   a DMA buffer.  A PRD may not cross a 64 kB boundary, and a
+   byte count of 0 means 64 kB. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address, word aligned. */
+    uint16_t size;              /* Byte count. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* Most queued requests merged into one command. */
+#define MERGE_MAX 8
+
+/* PRDs per table.  DISK_MULTIPLE_MAX sectors spread over
+   MERGE_MAX buffers need at most 2 + 2 * MERGE_MAX; a power of
+   two lets the table be aligned to its size. */
+#define PRD_CNT 32
 
 /* An ATA device. */
 struct disk 
@@ -57,9 +99,14 @@ struct disk
 
     bool is_ata;                /* 1=This device is an ATA disk. */
     disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
-
-    long long read_cnt;         /* Number of sectors read. */
-    long long write_cnt;        /* Number of sectors written. */
+    int multiple;               /* Sectors per interrupt for READ/WRITE
+                                   MULTIPLE, or 1 if not supported. */
+    bool dma;                   /* True to use bus-master DMA. */
+
+    struct disk_stats stats;    /* I/O statistics.  Updated under the
+                                   channel's queue_lock. */
+    uint64_t lock_wait_tsc;     /* TSC cycles behind stats.lock_wait_us. */
+    uint64_t busy_tsc;          /* TSC cycles behind stats.busy_us. */
   };
 
 /* An ATA channel (aka controller).
@@ -69,12 +116,23 @@ struct channel
     char name[8];               /* Name, e.g. "hd0". */
     uint16_t reg_base;          /* Base I/O port. */
     uint8_t irq;                /* Interrupt in use. */
+    uint16_t bm_base;           /* Bus-master IDE base port, or 0 if the
+                                   controller has none. */
+    struct prd *prdt;           /* PRD table for bus-master DMA. */
 
     struct lock lock;           /* Must acquire to access the controller. */
     bool expecting_interrupt;   /* True if an interrupt is expected, false if
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    /* Request queue, served by a per-channel worker thread. */
+    struct lock queue_lock;     /* Protects the members below. */
+    struct condition queue_ready;       /* Signaled on submit. */
+    struct list queue;          /* Pending requests, by request_key(). */
+    uint64_t head;              /* request_key() just past the last
+                                   request served. */
+    bool worker_started;        /* True once the worker is running. */
+
     struct disk devices[2];     /* The devices on this channel. */
   };
 
@@ -82,11 +140,25 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* One PRD table per channel.  Aligning each table to its own
+   size keeps it from crossing a 64 kB boundary. */
+static struct prd prd_tables[CHANNEL_CNT][PRD_CNT]
+  __attribute__ ((aligned (sizeof (struct prd) * PRD_CNT)));
+
+/* TSC cycles per millisecond, measured by calibrate_tsc(). */
+static uint64_t tsc_per_ms;
+
+static void calibrate_tsc (void);
+static uint64_t rdtsc (void);
+static long long tsc_to_us (uint64_t);
+static void lock_acquire_timed (struct lock *, struct disk *);
+
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void set_multiple_mode (struct disk *, int);
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -96,6 +168,15 @@ static bool wait_while_busy (const struct disk *);
 static void select_device (const struct disk *);
 static void select_device_wait (const struct disk *);
 
+static void disk_worker (void *channel_);
+static size_t take_batch (struct channel *, struct disk_request **);
+static void serve_batch (struct disk_request **, size_t n);
+
+static uint16_t find_bus_master (void);
+static bool dma_transfer (struct disk_request **, size_t n, size_t cnt);
+static void pio_read (struct disk_request **, size_t cnt);
+static void pio_write (struct disk_request **, size_t cnt);
+
 static void interrupt_handler (struct intr_frame *);
 
 /* Initialize the disk subsystem and detect disks. */
@@ -103,6 +184,9 @@ void
 disk_init (void) 
 {
   size_t chan_no;
+  uint16_t bm_base = find_bus_master ();
+
+  calibrate_tsc ();
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
@@ -124,9 +208,16 @@ disk_init (void)
         default:
           NOT_REACHED ();
         }
+      c->bm_base = bm_base != 0 ? bm_base + 8 * chan_no : 0;
+      c->prdt = prd_tables[chan_no];
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      lock_init (&c->queue_lock);
+      cond_init (&c->queue_ready);
+      list_init (&c->queue);
+      c->head = 0;
+      c->worker_started = false;
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -138,8 +229,11 @@ disk_init (void)
 
           d->is_ata = false;
           d->capacity = 0;
+          d->multiple = 1;
+          d->dma = false;
 
-          d->read_cnt = d->write_cnt = 0;
+          memset (&d->stats, 0, sizeof d->stats);
+          d->lock_wait_tsc = d->busy_tsc = 0;
         }
 
       /* Register interrupt handler. */
@@ -156,6 +250,14 @@ disk_init (void)
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
           identify_ata_device (&c->devices[dev_no]);
+
+      /* Start the channel's request queue. */
+      if (c->devices[0].is_ata || c->devices[1].is_ata)
+        {
+          if (thread_create (c->name, PRI_MAX, disk_worker, c) == TID_ERROR)
+            PANIC ("%s: can't start disk worker", c->name);
+          c->worker_started = true;
+        }
     }
 }
 
@@ -172,13 +274,61 @@ disk_print_stats (void)
       for (dev_no = 0; dev_no < 2; dev_no++) 
         {
           struct disk *d = disk_get (chan_no, dev_no);
-          if (d != NULL && d->is_ata) 
-            printf ("%s: %lld reads, %lld writes\n",
-                    d->name, d->read_cnt, d->write_cnt);
+          struct disk_stats st;
+          int i;
+
+          if (d == NULL || !d->is_ata) 
+            continue;
+
+          disk_get_stats (d, &st);
+          printf ("%s: %lld reads, %lld writes\n",
+                  d->name, st.read_cnt, st.write_cnt);
+          if (st.requests == 0)
+            continue;
+          printf ("%s: %lld bytes read, %lld bytes written, "
+                  "%lld requests in %lld commands, busy %lld us\n",
+                  d->name, st.read_bytes, st.write_bytes,
+                  st.requests, st.commands, st.busy_us);
+          printf ("%s: queue depth avg %lld.%02lld max %d, "
+                  "lock wait %lld us\n",
+                  d->name, st.queue_depth_sum / st.requests,
+                  st.queue_depth_sum * 100 / st.requests % 100,
+                  st.max_queue_depth, st.lock_wait_us);
+          printf ("%s: latency (us):", d->name);
+          for (i = 0; i < DISK_LATENCY_BUCKETS; i++)
+            if (st.latency[i] != 0)
+              {
+                if (i == 0)
+                  printf (" <1:%lld", st.latency[i]);
+                else if (i == DISK_LATENCY_BUCKETS - 1)
+                  printf (" >=%d:%lld", 1 << (i - 1), st.latency[i]);
+                else
+                  printf (" %d-%d:%lld", 1 << (i - 1), 1 << i, st.latency[i]);
+              }
+          printf ("\n");
         }
     }
 }
 
+/* Copies a snapshot of disk D's I/O statistics into *ST. */
+void
+disk_get_stats (struct disk *d, struct disk_stats *st) 
+{
+  struct channel *c;
+
+  ASSERT (d != NULL);
+  ASSERT (st != NULL);
+
+  c = d->channel;
+  if (c->worker_started)
+    lock_acquire (&c->queue_lock);
+  *st = d->stats;
+  st->lock_wait_us = tsc_to_us (d->lock_wait_tsc);
+  st->busy_us = tsc_to_us (d->busy_tsc);
+  if (c->worker_started)
+    lock_release (&c->queue_lock);
+}
+
 /* Returns the disk numbered DEV_NO--either 0 or 1 for master or
    slave, respectively--within the channel numbered CHAN_NO.
 
@@ -219,21 +369,7 @@ disk_size (struct disk *d)
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) 
 {
-  struct channel *c;
-  
-  ASSERT (d != NULL);
-  ASSERT (buffer != NULL);
-
-  c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
-  d->read_cnt++;
-  lock_release (&c->lock);
+  disk_read_multiple (d, sec_no, buffer, 1);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -244,23 +380,326 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer)
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer)
 {
-  struct channel *c;
-  
+  disk_write_multiple (d, sec_no, buffer, 1);
+}
+
+/* Reads CNT contiguous sectors starting at SEC_NO from disk D
+   into BUFFER, which must have room for CNT * DISK_SECTOR_SIZE
+   bytes.  CNT may be up to DISK_MULTIPLE_MAX.  The read goes
+   through D's channel request queue, and this function returns
+   once it is done.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_read_multiple (struct disk *d, disk_sector_t sec_no, void *buffer,
+                    size_t cnt) 
+{
+  struct disk_request r;
+
+  disk_request_init (&r, d, sec_no, buffer, cnt, false);
+  disk_submit (&r);
+  disk_wait (&r);
+}
+
+/* Writes CNT contiguous sectors starting at SEC_NO to disk D
+   from BUFFER, which must contain CNT * DISK_SECTOR_SIZE bytes.
+   CNT may be up to DISK_MULTIPLE_MAX.  Returns after the disk
+   has acknowledged receiving the data.
+   Internally synchronizes accesses to disks, so external
+   per-disk locking is unneeded. */
+void
+disk_write_multiple (struct disk *d, disk_sector_t sec_no,
+                     const void *buffer, size_t cnt)
+{
+  struct disk_request r;
+
+  disk_request_init (&r, d, sec_no, (void *) buffer, cnt, true);
+  disk_submit (&r);
+  disk_wait (&r);
+}
+
+/* Asynchronous requests. */
+
+/* Initializes R as a request to transfer CNT sectors starting at
+   SEC_NO between disk D and BUFFER, writing to the disk if WRITE
+   is true and reading from it otherwise.  CNT may be up to
+   DISK_MULTIPLE_MAX.  R has no completion callback; set R->done
+   and R->aux afterward to add one. */
+void
+disk_request_init (struct disk_request *r, struct disk *d,
+                   disk_sector_t sec_no, void *buffer, size_t cnt,
+                   bool write) 
+{
+  ASSERT (r != NULL);
   ASSERT (d != NULL);
   ASSERT (buffer != NULL);
+  ASSERT (cnt > 0 && cnt <= DISK_MULTIPLE_MAX);
+  ASSERT (sec_no + cnt <= d->capacity);
+
+  r->disk = d;
+  r->sector = sec_no;
+  r->buffer = buffer;
+  r->cnt = cnt;
+  r->write = write;
+  r->done = NULL;
+  r->aux = NULL;
+  r->submit_tsc = 0;
+  sema_init (&r->finished, 0);
+}
 
-  c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  d->write_cnt++;
-  lock_release (&c->lock);
+/* Orders requests by device, then by starting sector, so that
+   one sweep of a channel's queue serves master and slave in
+   ascending sector order. */
+static uint64_t
+request_key (const struct disk_request *r) 
+{
+  return ((uint64_t) r->disk->dev_no << 32) | r->sector;
 }
-
+
+static bool
+request_less (const struct list_elem *a_, const struct list_elem *b_,
+              void *aux UNUSED) 
+{
+  const struct disk_request *a = list_entry (a_, struct disk_request, elem);
+  const struct disk_request *b = list_entry (b_, struct disk_request, elem);
+
+  return request_key (a) < request_key (b);
+}
+
+/* Queues R on its disk's channel and returns without waiting.
+   When R completes, its callback (if any) runs in the channel's
+   worker thread, and then disk_wait(R) returns.  R and its buffer
+   must stay valid until then.  The queue may reorder requests,
+   so a caller must not have two requests for overlapping
+   sectors outstanding if one of them is a write. */
+void
+disk_submit (struct disk_request *r) 
+{
+  struct disk *d = r->disk;
+  struct channel *c = d->channel;
+
+  r->submit_tsc = rdtsc ();
+  if (!c->worker_started)
+    {
+      /* Too early in boot for the queue: serve R right here. */
+      d->stats.queue_depth_sum++;
+      if (d->stats.max_queue_depth < 1)
+        d->stats.max_queue_depth = 1;
+      d->stats.queue_depth++;
+      lock_acquire_timed (&c->lock, d);
+      serve_batch (&r, 1);
+      lock_release (&c->lock);
+      return;
+    }
+
+  lock_acquire_timed (&c->queue_lock, d);
+  d->stats.queue_depth_sum += ++d->stats.queue_depth;
+  if (d->stats.queue_depth > d->stats.max_queue_depth)
+    d->stats.max_queue_depth = d->stats.queue_depth;
+  list_insert_ordered (&c->queue, &r->elem, request_less, NULL);
+  cond_signal (&c->queue_ready, &c->queue_lock);
+  lock_release (&c->queue_lock);
+}
+
+/* Waits for R, which must have been passed to disk_submit(), to
+   complete. */
+void
+disk_wait (struct disk_request *r) 
+{
+  sema_down (&r->finished);
+}
+
+/* Worker thread for channel CHANNEL_: repeatedly takes the next
+   batch of requests off the queue and performs it. */
+static void
+disk_worker (void *channel_) 
+{
+  struct channel *c = channel_;
+  struct disk_request *batch[MERGE_MAX];
+
+  for (;;) 
+    {
+      size_t n = take_batch (c, batch);
+
+      lock_acquire_timed (&c->lock, batch[0]->disk);
+      serve_batch (batch, n);
+      lock_release (&c->lock);
+    }
+}
+
+/* Waits for C's queue to be nonempty, then removes the next
+   requests to serve and stores them in BATCH, returning how many
+   there are.
+
+   The choice is C-LOOK: the first request at or past the head
+   position, wrapping around to the lowest sector when nothing is
+   left ahead of it, so the disk sweeps in one direction and no
+   request starves.  Requests that continue it exactly, in the
+   same direction on the same disk, are merged into the batch, up
+   to MERGE_MAX requests and DISK_MULTIPLE_MAX sectors. */
+static size_t
+take_batch (struct channel *c, struct disk_request **batch) 
+{
+  struct list_elem *e;
+  struct disk_request *r;
+  size_t n, cnt;
+
+  lock_acquire (&c->queue_lock);
+  while (list_empty (&c->queue))
+    cond_wait (&c->queue_ready, &c->queue_lock);
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    if (request_key (list_entry (e, struct disk_request, elem)) >= c->head)
+      break;
+  if (e == list_end (&c->queue))
+    e = list_begin (&c->queue);
+
+  r = list_entry (e, struct disk_request, elem);
+  batch[0] = r;
+  n = 1;
+  cnt = r->cnt;
+  e = list_remove (e);
+  while (n < MERGE_MAX && e != list_end (&c->queue))
+    {
+      struct disk_request *next = list_entry (e, struct disk_request, elem);
+      if (next->disk != r->disk || next->write != r->write
+          || next->sector != batch[n - 1]->sector + batch[n - 1]->cnt
+          || cnt + next->cnt > DISK_MULTIPLE_MAX)
+        break;
+      batch[n++] = next;
+      cnt += next->cnt;
+      e = list_remove (e);
+    }
+  c->head = request_key (batch[n - 1]) + batch[n - 1]->cnt;
+  lock_release (&c->queue_lock);
+  return n;
+}
+
+/* Performs the N requests in BATCH, which cover contiguous
+   sectors on one disk in one direction, as a single command,
+   then completes each of them.  The channel lock must be
+   held. */
+static void
+serve_batch (struct disk_request **batch, size_t n) 
+{
+  struct disk *d = batch[0]->disk;
+  struct channel *c = d->channel;
+  uint64_t start, end;
+  size_t cnt = 0;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  for (i = 0; i < n; i++)
+    cnt += batch[i]->cnt;
+
+  start = rdtsc ();
+  if (!dma_transfer (batch, n, cnt))
+    {
+      if (batch[0]->write)
+        pio_write (batch, cnt);
+      else
+        pio_read (batch, cnt);
+    }
+  end = rdtsc ();
+
+  if (c->worker_started)
+    lock_acquire (&c->queue_lock);
+  if (batch[0]->write)
+    {
+      d->stats.write_cnt += cnt;
+      d->stats.write_bytes += cnt * DISK_SECTOR_SIZE;
+    }
+  else
+    {
+      d->stats.read_cnt += cnt;
+      d->stats.read_bytes += cnt * DISK_SECTOR_SIZE;
+    }
+  d->stats.commands++;
+  d->stats.requests += n;
+  d->stats.queue_depth -= n;
+  d->busy_tsc += end - start;
+  for (i = 0; i < n; i++)
+    {
+      long long us = tsc_to_us (end - batch[i]->submit_tsc);
+      int bucket = 0;
+      while (us > 0 && bucket < DISK_LATENCY_BUCKETS - 1)
+        {
+          us >>= 1;
+          bucket++;
+        }
+      d->stats.latency[bucket]++;
+    }
+  if (c->worker_started)
+    lock_release (&c->queue_lock);
+
+  for (i = 0; i < n; i++)
+    {
+      struct disk_request *r = batch[i];
+      if (r->done != NULL)
+        r->done (r, r->aux);
+      sema_up (&r->finished);
+    }
+}
+
+/* Timing. */
+
+/* Reads the CPU's time-stamp counter. */
+static uint64_t
+rdtsc (void) 
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
+/* Measures how fast the time-stamp counter runs, by counting its
+   cycles across one timer tick. */
+static void
+calibrate_tsc (void) 
+{
+  int64_t start;
+  uint64_t tsc;
+
+  ASSERT (intr_get_level () == INTR_ON);
+
+  start = timer_ticks ();
+  while (timer_ticks () == start)
+    barrier ();
+  start = timer_ticks ();
+  tsc = rdtsc ();
+  while (timer_ticks () == start)
+    barrier ();
+  tsc_per_ms = (rdtsc () - tsc) * TIMER_FREQ / 1000;
+  if (tsc_per_ms == 0)
+    tsc_per_ms = 1;
+}
+
+/* Converts a count of TSC cycles to microseconds. */
+static long long
+tsc_to_us (uint64_t tsc) 
+{
+  return tsc * 1000 / tsc_per_ms;
+}
+
+/* Acquires LOCK, charging the time spent waiting for it to disk
+   D's lock_wait statistic. */
+static void
+lock_acquire_timed (struct lock *lock, struct disk *d) 
+{
+  uint64_t start = rdtsc ();
+  enum intr_level old_level;
+
+  lock_acquire (lock);
+
+  /* D's queue and channel locks both come through here, so
+     neither of them protects the sum. */
+  old_level = intr_disable ();
+  d->lock_wait_tsc += rdtsc () - start;
+  intr_set_level (old_level);
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -386,6 +825,14 @@ identify_ata_device (struct disk *d)
   /* Calculate capacity. */
   d->capacity = id[60] | ((uint32_t) id[61] << 16);
 
+  /* Word 47 gives the most sectors READ/WRITE MULTIPLE can
+     move per interrupt, or 0 if they are not supported. */
+  if ((id[47] & 0xff) > 1)
+    set_multiple_mode (d, id[47] & 0xff);
+
+  /* Word 49 bit 8 says whether the disk can do DMA. */
+  d->dma = c->bm_base != 0 && (id[49] & 0x100) != 0;
+
   /* Print identification message. */
   printf ("%s: detected %'"PRDSNu" sector (", d->name, d->capacity);
   if (d->capacity > 1024 / DISK_SECTOR_SIZE * 1024 * 1024)
@@ -404,6 +851,23 @@ identify_ata_device (struct disk *d)
   printf ("\"\n");
 }
 
+/* Sends a SET MULTIPLE MODE command to disk D so that READ/WRITE
+   MULTIPLE transfer CNT sectors per interrupt, and records CNT
+   in D on success. */
+static void
+set_multiple_mode (struct disk *d, int cnt) 
+{
+  struct channel *c = d->channel;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), cnt);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if (!(inb (reg_status (c)) & STA_ERR))
+    d->multiple = cnt;
+}
+
 /* Prints STRING, which consists of SIZE bytes in a funky format:
    each pair of bytes is in reverse order.  Does not print
    trailing whitespace and/or nulls. */
@@ -426,18 +890,20 @@ print_ata_string (char *string, size_t size)
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT to the disk's sector
+   selection registers.  (We use LBA mode.)  A count of 256 is
+   written as 0, as ATA specifies. */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) 
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) 
 {
   struct channel *c = d->channel;
 
-  ASSERT (sec_no < d->capacity);
-  ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt > 0 && cnt <= DISK_MULTIPLE_MAX);
+  ASSERT (sec_no + cnt <= d->capacity);
+  ASSERT (sec_no + cnt <= (1UL << 28));
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt == DISK_MULTIPLE_MAX ? 0 : cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -474,6 +940,204 @@ output_sector (struct channel *c, const void *sector)
   outsw (reg_data (c), sector, DISK_SECTOR_SIZE / 2);
 }
 
+/* Returns the buffer for sector IDX of the batch that starts
+   with BATCH[0], counting across the requests in order. */
+static uint8_t *
+batch_sector (struct disk_request **batch, size_t idx) 
+{
+  for (; idx >= (*batch)->cnt; batch++)
+    idx -= (*batch)->cnt;
+  return (uint8_t *) (*batch)->buffer + idx * DISK_SECTOR_SIZE;
+}
+
+/* Reads the CNT sectors of BATCH with programmed I/O.  The
+   channel lock must be held. */
+static void
+pio_read (struct disk_request **batch, size_t cnt) 
+{
+  struct disk *d = batch[0]->disk;
+  struct channel *c = d->channel;
+  disk_sector_t sec_no = batch[0]->sector;
+  size_t per_intr = cnt > 1 ? d->multiple : 1;
+  size_t done;
+
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, per_intr > 1 ? CMD_READ_MULTIPLE
+                                     : CMD_READ_SECTOR_RETRY);
+  for (done = 0; done < cnt; )
+    {
+      size_t block = cnt - done < per_intr ? cnt - done : per_intr;
+
+      sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk read failed, sector=%"PRDSNu,
+               d->name, sec_no + done);
+      for (; block > 0; block--, done++)
+        input_sector (c, batch_sector (batch, done));
+    }
+}
+
+/* Writes the CNT sectors of BATCH with programmed I/O.  The
+   channel lock must be held. */
+static void
+pio_write (struct disk_request **batch, size_t cnt) 
+{
+  struct disk *d = batch[0]->disk;
+  struct channel *c = d->channel;
+  disk_sector_t sec_no = batch[0]->sector;
+  size_t per_intr = cnt > 1 ? d->multiple : 1;
+  size_t done;
+
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, per_intr > 1 ? CMD_WRITE_MULTIPLE
+                                     : CMD_WRITE_SECTOR_RETRY);
+  for (done = 0; done < cnt; )
+    {
+      size_t block = cnt - done < per_intr ? cnt - done : per_intr;
+
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk write failed, sector=%"PRDSNu,
+               d->name, sec_no + done);
+      for (; block > 0; block--, done++)
+        output_sector (c, batch_sector (batch, done));
+      sema_down (&c->completion_wait);
+    }
+}
+
+/* Bus-master DMA. */
+
+/* Reads the 32-bit register at OFFSET in the configuration space
+   of PCI function FUNC of device DEV on bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int offset) 
+{
+  outl (0xcf8, 0x80000000 | (dev << 11) | (func << 8) | (offset & 0xfc));
+  return inl (0xcfc);
+}
+
+/* Writes DATA to the 32-bit register at OFFSET in the
+   configuration space of PCI function FUNC of device DEV on
+   bus 0. */
+static void
+pci_write_config (int dev, int func, int offset, uint32_t data) 
+{
+  outl (0xcf8, 0x80000000 | (dev << 11) | (func << 8) | (offset & 0xfc));
+  outl (0xcfc, data);
+}
+
+/* Looks on PCI bus 0 for an IDE controller with bus-master
+   support, such as the PIIX that QEMU emulates, and turns on its
+   bus mastering.  Returns the base I/O port of its bus-master
+   registers (the primary channel's; the secondary's are 8
+   higher), or 0 if there is no such controller. */
+static uint16_t
+find_bus_master (void) 
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t id = pci_read_config (dev, func, 0x00);
+        uint32_t class = pci_read_config (dev, func, 0x08);
+        uint32_t bar4;
+
+        if ((id & 0xffff) == 0xffff)
+          {
+            if (func == 0)
+              break;
+            continue;
+          }
+
+        /* Class 1 (mass storage), subclass 1 (IDE), with the
+           bus-master bit set in the programming interface. */
+        if ((class >> 16) != 0x0101 || !(class & 0x8000))
+          continue;
+        bar4 = pci_read_config (dev, func, 0x20);
+        if (!(bar4 & 1))
+          continue;
+
+        /* Enable I/O space and bus mastering. */
+        pci_write_config (dev, func, 0x04,
+                          (pci_read_config (dev, func, 0x04) & 0xffff)
+                          | 0x05);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
+/* Transfers the CNT sectors of the N requests in BATCH by
+   bus-master DMA, with one PRD list covering every request's
+   buffer.  The channel lock must be held.  Returns false without
+   touching the disk if the disk cannot do DMA or some buffer is
+   not usable for it, in which case the caller falls back to PIO.
+   A DMA error turns DMA off for the disk, so later transfers use
+   PIO too. */
+static bool
+dma_transfer (struct disk_request **batch, size_t n, size_t cnt) 
+{
+  struct disk *d = batch[0]->disk;
+  struct channel *c = d->channel;
+  disk_sector_t sec_no = batch[0]->sector;
+  bool read = !batch[0]->write;
+  uint8_t status;
+  size_t i;
+  int prd = 0;
+
+  if (!d->dma)
+    return false;
+
+  /* The controller needs word-aligned physical addresses.  Kernel
+     virtual memory maps physical memory linearly, so a kernel
+     buffer is physically contiguous. */
+  for (i = 0; i < n; i++)
+    if (!is_kernel_vaddr (batch[i]->buffer)
+        || ((uintptr_t) batch[i]->buffer & 1))
+      return false;
+
+  /* Describe each buffer, split at 64 kB boundaries. */
+  for (i = 0; i < n; i++)
+    {
+      uintptr_t addr = vtop (batch[i]->buffer);
+      uintptr_t end = addr + batch[i]->cnt * DISK_SECTOR_SIZE;
+
+      while (addr < end)
+        {
+          uintptr_t next = (addr & ~(uintptr_t) 0xffff) + 0x10000;
+          if (next > end)
+            next = end;
+          ASSERT (prd < PRD_CNT);
+          c->prdt[prd].addr = addr;
+          c->prdt[prd].size = next - addr;
+          c->prdt[prd].flags = 0;
+          prd++;
+          addr = next;
+        }
+    }
+  c->prdt[prd - 1].flags = PRD_EOT;
+
+  outl (c->bm_base + BM_PRDT, vtop (c->prdt));
+  outb (c->bm_base + BM_COMMAND, read ? BM_CMD_WRITE : 0);
+  outb (c->bm_base + BM_STATUS, BM_STA_ERROR | BM_STA_INTR);
+
+  select_sectors (d, sec_no, cnt);
+  issue_pio_command (c, read ? CMD_READ_DMA : CMD_WRITE_DMA);
+  outb (c->bm_base + BM_COMMAND, (read ? BM_CMD_WRITE : 0) | BM_CMD_START);
+  sema_down (&c->completion_wait);
+
+  outb (c->bm_base + BM_COMMAND, 0);
+  status = inb (c->bm_base + BM_STATUS);
+  outb (c->bm_base + BM_STATUS, BM_STA_ERROR | BM_STA_INTR);
+  if ((status & BM_STA_ERROR) || (inb (reg_status (c)) & STA_ERR))
+    {
+      printf ("%s: DMA %s failed at sector %"PRDSNu", using PIO\n",
+              d->name, read ? "read" : "write", sec_no);
+      d->dma = false;
+      return false;
+    }
+  return true;
+}
+
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
@@ -1,8 +1,13 @@
 #ifndef DEVICES_DISK_H
 #define DEVICES_DISK_H
 
+#include <disk-stats.h>
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
@@ -15,12 +20,46 @@ typedef uint32_t disk_sector_t;
    printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* Most sectors that one disk_read_multiple() or
+   disk_write_multiple() call may transfer. */
+#define DISK_MULTIPLE_MAX 256
+
+/* An asynchronous disk request, for disk_submit(). */
+struct disk_request
+  {
+    struct list_elem elem;      /* Element in channel's queue. */
+    struct disk *disk;          /* Disk to transfer to or from. */
+    disk_sector_t sector;       /* First sector. */
+    void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+    size_t cnt;                 /* Number of sectors. */
+    bool write;                 /* True to write, false to read. */
+
+    /* Called from the disk's worker thread when the transfer is
+       done, before disk_wait() returns.  Must not sleep, since
+       the channel's queue stalls until it returns.  May be
+       null. */
+    void (*done) (struct disk_request *, void *aux);
+    void *aux;                  /* Passed to DONE. */
+    struct semaphore finished;  /* Up'd on completion. */
+    uint64_t submit_tsc;        /* Time of disk_submit(), for stats. */
+  };
+
 void disk_init (void);
 void disk_print_stats (void);
+void disk_get_stats (struct disk *, struct disk_stats *);
 
 struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
+void disk_read_multiple (struct disk *, disk_sector_t, void *, size_t cnt);
+void disk_write_multiple (struct disk *, disk_sector_t, const void *,
+                          size_t cnt);
+
+void disk_request_init (struct disk_request *, struct disk *,
+                        disk_sector_t, void *buffer, size_t cnt,
+                        bool write);
+void disk_submit (struct disk_request *);
+void disk_wait (struct disk_request *);
 
 #endif /* devices/disk.h */
@@ -0,0 +1,134 @@
+#include "devices/stripe.h"
+#include <debug.h>
+#include "threads/malloc.h"
+
+/* A striped block device: a single sector space laid across
+   several disks in CHUNK-sector pieces, round robin.  Disks on
+   different channels are served by different channel workers,
+   so a transfer that covers several chunks keeps all of them
+   busy at once.  Sector S lives on disk (S / CHUNK) % DISK_CNT,
+   at sector (S / CHUNK / DISK_CNT) * CHUNK + S % CHUNK of that
+   disk. */
+struct stripe 
+  {
+    struct disk *disks[STRIPE_MAX_DISKS];       /* Member disks. */
+    size_t disk_cnt;            /* Number of member disks. */
+    disk_sector_t chunk;        /* Sectors per chunk. */
+    disk_sector_t size;         /* Total size in sectors. */
+  };
+
+/* Most chunk requests in flight at once for one transfer. */
+#define STRIPE_BATCH 8
+
+static void transfer (struct stripe *, disk_sector_t, void *, size_t cnt,
+                      bool write);
+
+/* Creates a stripe set over the DISK_CNT disks in DISKS, which
+   must be distinct, with CHUNK sectors per chunk.  Each disk
+   contributes as many whole chunks as the smallest disk holds.
+   Returns the new stripe set, or a null pointer if memory
+   allocation fails. */
+struct stripe *
+stripe_create (struct disk **disks, size_t disk_cnt, disk_sector_t chunk) 
+{
+  struct stripe *st;
+  disk_sector_t per_disk;
+  size_t i;
+
+  ASSERT (disks != NULL);
+  ASSERT (disk_cnt > 0 && disk_cnt <= STRIPE_MAX_DISKS);
+  ASSERT (chunk > 0 && chunk <= DISK_MULTIPLE_MAX);
+
+  st = malloc (sizeof *st);
+  if (st == NULL)
+    return NULL;
+
+  per_disk = disk_size (disks[0]);
+  for (i = 0; i < disk_cnt; i++)
+    {
+      ASSERT (disks[i] != NULL);
+      st->disks[i] = disks[i];
+      if (disk_size (disks[i]) < per_disk)
+        per_disk = disk_size (disks[i]);
+    }
+  st->disk_cnt = disk_cnt;
+  st->chunk = chunk;
+  st->size = per_disk / chunk * chunk * disk_cnt;
+  return st;
+}
+
+/* Destroys stripe set ST.  The member disks are not affected. */
+void
+stripe_destroy (struct stripe *st) 
+{
+  free (st);
+}
+
+/* Returns the size of ST in DISK_SECTOR_SIZE-byte sectors. */
+disk_sector_t
+stripe_size (const struct stripe *st) 
+{
+  ASSERT (st != NULL);
+
+  return st->size;
+}
+
+/* Reads CNT sectors starting at SEC_NO from ST into BUFFER,
+   which must have room for CNT * DISK_SECTOR_SIZE bytes. */
+void
+stripe_read (struct stripe *st, disk_sector_t sec_no, void *buffer,
+             size_t cnt) 
+{
+  transfer (st, sec_no, buffer, cnt, false);
+}
+
+/* Writes CNT sectors starting at SEC_NO to ST from BUFFER, which
+   must contain CNT * DISK_SECTOR_SIZE bytes.  Returns after every
+   member disk has acknowledged its part. */
+void
+stripe_write (struct stripe *st, disk_sector_t sec_no, const void *buffer,
+              size_t cnt) 
+{
+  transfer (st, sec_no, (void *) buffer, cnt, true);
+}
+
+/* Transfers CNT sectors starting at SEC_NO between ST and BUFFER.
+   Splits the transfer at chunk boundaries and submits up to
+   STRIPE_BATCH pieces to the member disks before waiting for any
+   of them. */
+static void
+transfer (struct stripe *st, disk_sector_t sec_no, void *buffer, size_t cnt,
+          bool write) 
+{
+  struct disk_request reqs[STRIPE_BATCH];
+  uint8_t *p = buffer;
+
+  ASSERT (st != NULL);
+  ASSERT (buffer != NULL);
+  ASSERT (sec_no <= st->size && cnt <= st->size - sec_no);
+
+  while (cnt > 0)
+    {
+      size_t n, i;
+
+      for (n = 0; n < STRIPE_BATCH && cnt > 0; n++)
+        {
+          disk_sector_t chunk_no = sec_no / st->chunk;
+          disk_sector_t chunk_ofs = sec_no % st->chunk;
+          struct disk *d = st->disks[chunk_no % st->disk_cnt];
+          disk_sector_t d_sec = chunk_no / st->disk_cnt * st->chunk + chunk_ofs;
+          size_t piece = st->chunk - chunk_ofs;
+
+          if (piece > cnt)
+            piece = cnt;
+          disk_request_init (&reqs[n], d, d_sec, p, piece, write);
+          disk_submit (&reqs[n]);
+
+          sec_no += piece;
+          p += piece * DISK_SECTOR_SIZE;
+          cnt -= piece;
+        }
+      for (i = 0; i < n; i++)
+        disk_wait (&reqs[i]);
+    }
+}
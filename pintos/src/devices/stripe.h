@@ -0,0 +1,18 @@
+#ifndef DEVICES_STRIPE_H
+#define DEVICES_STRIPE_H
+
+#include <stddef.h>
+#include "devices/disk.h"
+
+/* Most disks that one stripe set can span. */
+#define STRIPE_MAX_DISKS 4
+
+struct stripe *stripe_create (struct disk **, size_t disk_cnt,
+                              disk_sector_t chunk);
+void stripe_destroy (struct stripe *);
+disk_sector_t stripe_size (const struct stripe *);
+void stripe_read (struct stripe *, disk_sector_t, void *, size_t cnt);
+void stripe_write (struct stripe *, disk_sector_t, const void *,
+                   size_t cnt);
+
+#endif /* devices/stripe.h */
@@ -7,6 +7,7 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
 #include "threads/malloc.h"
 
@@ -36,12 +37,24 @@ cache_entry_find(disk_sector_t sector)
     return NULL;
 }
 
+/* Evicts the oldest entry that the journal has not pinned.  The
+   journal pins far fewer than MAX_CACHE_SIZE entries, so there
+   always is one. */
 void
 cache_entry_evict()
 {
     ASSERT (lock_held_by_current_thread(&cache_lock));
 
-    struct cache_entry *evict_entry = list_entry(list_pop_front(&cache_entry_list), struct cache_entry, elem);
+    struct list_elem *e;
+    struct cache_entry *evict_entry = NULL;
+    for(e = list_begin(&cache_entry_list); e != list_end(&cache_entry_list); e = list_next(e))
+    {
+        evict_entry = list_entry(e, struct cache_entry, elem);
+        if (!evict_entry->logged)
+            break;
+    }
+    ASSERT (e != list_end(&cache_entry_list));
+    list_remove(e);
     if (evict_entry->dirty) {
         cache_entry_back_to_disk(evict_entry);
     }
@@ -55,9 +68,10 @@ cache_entry_add(disk_sector_t sector)
     ASSERT (lock_held_by_current_thread(&cache_lock));
     struct cache_entry *cache_entry = malloc(sizeof(struct cache_entry));
     
-    disk_read(filesys_disk, sector, cache_entry->data);
+    filesys_read(sector, cache_entry->data, 1);
     cache_entry->sector = sector;
     cache_entry->dirty = 0;
+    cache_entry->logged = false;
 
     list_push_back(&cache_entry_list, &cache_entry->elem);
     return cache_entry;
@@ -93,6 +107,7 @@ cache_write_from_buffer (disk_sector_t sector, void *buffer)
     // printf("___DEBUG____cache write from buffer %d \n", sector);
     // hex_dump(buffer, buffer, 4, 0);
 
+    journal_reserve();
     lock_acquire(&cache_lock);
     struct cache_entry *cache_entry = cache_entry_find(sector);
     if (cache_entry == NULL) // no cache entry
@@ -107,6 +122,101 @@ cache_write_from_buffer (disk_sector_t sector, void *buffer)
 
     memcpy(cache_entry->data, buffer, DISK_SECTOR_SIZE);
     cache_entry->dirty = 1; //
+    journal_log(cache_entry);
+    lock_release(&cache_lock);
+    journal_unreserve();
+}
+
+/* Copies SIZE bytes from BUFFER into the cached copy of SECTOR,
+   starting SECTOR_OFS bytes into the sector.  The rest of the
+   sector is left as it was, and the whole update happens under
+   cache_lock. */
+void
+cache_write_at (disk_sector_t sector, const void *buffer, int sector_ofs, int size)
+{
+    ASSERT (sector_ofs >= 0 && size >= 0);
+    ASSERT (sector_ofs + size <= DISK_SECTOR_SIZE);
+
+    journal_reserve();
+    lock_acquire(&cache_lock);
+    struct cache_entry *cache_entry = cache_entry_find(sector);
+    if (cache_entry == NULL) // no cache entry
+    {
+        if (list_size(&cache_entry_list) >= MAX_CACHE_SIZE)
+            cache_entry_evict();
+        cache_entry = cache_entry_add(sector);
+    }
+
+    memcpy(cache_entry->data + sector_ofs, buffer, size);
+    cache_entry->dirty = 1;
+    journal_log(cache_entry);
+    lock_release(&cache_lock);
+    journal_unreserve();
+}
+
+/* Copies SIZE bytes starting SRC_OFS bytes into sector SRC to
+   DST_OFS bytes into sector DST, cache entry to cache entry,
+   without bouncing the data through a caller's buffer.  Used
+   for file data only, so the write is never journaled. */
+void
+cache_copy (disk_sector_t dst, int dst_ofs, disk_sector_t src, int src_ofs, int size)
+{
+    ASSERT (dst_ofs >= 0 && src_ofs >= 0 && size >= 0);
+    ASSERT (dst_ofs + size <= DISK_SECTOR_SIZE);
+    ASSERT (src_ofs + size <= DISK_SECTOR_SIZE);
+
+    lock_acquire(&cache_lock);
+    struct cache_entry *src_entry = cache_entry_find(src);
+    if (src_entry == NULL)
+    {
+        if (list_size(&cache_entry_list) >= MAX_CACHE_SIZE)
+            cache_entry_evict();
+        src_entry = cache_entry_add(src);
+    }
+    else
+    {
+        /* Move the source to the back so that making room for the
+           destination below cannot evict it. */
+        list_remove(&src_entry->elem);
+        list_push_back(&cache_entry_list, &src_entry->elem);
+    }
+
+    struct cache_entry *dst_entry = cache_entry_find(dst);
+    if (dst_entry == NULL)
+    {
+        if (list_size(&cache_entry_list) >= MAX_CACHE_SIZE)
+            cache_entry_evict();
+        dst_entry = cache_entry_add(dst);
+    }
+
+    journal_forget(dst);
+    memmove(dst_entry->data + dst_ofs, src_entry->data + src_ofs, size);
+    dst_entry->dirty = 1;
+    lock_release(&cache_lock);
+}
+
+/* Fills SECTOR with zeros.  Used for freshly allocated data
+   sectors, which is not metadata, so the write is never
+   journaled, and there is no need to read the old contents
+   from disk first. */
+void
+cache_zero (disk_sector_t sector)
+{
+    lock_acquire(&cache_lock);
+    struct cache_entry *cache_entry = cache_entry_find(sector);
+    if (cache_entry == NULL) // no cache entry
+    {
+        if (list_size(&cache_entry_list) >= MAX_CACHE_SIZE)
+            cache_entry_evict();
+        cache_entry = malloc(sizeof(struct cache_entry));
+        cache_entry->sector = sector;
+        cache_entry->logged = false;
+        list_push_back(&cache_entry_list, &cache_entry->elem);
+    }
+
+    journal_forget(sector);
+    memset(cache_entry->data, 0, DISK_SECTOR_SIZE);
+    cache_entry->dirty = 1;
     lock_release(&cache_lock);
 }
 
@@ -141,7 +251,7 @@ void cache_entry_back_to_disk(struct cache_entry *cache_entry)
     ASSERT (lock_held_by_current_thread(&cache_lock));
     ASSERT (cache_entry != NULL);
 
-    disk_write (filesys_disk, cache_entry->sector, cache_entry->data);
+    filesys_write (cache_entry->sector, cache_entry->data, 1);
     cache_entry->dirty = false;
 }
 
@@ -155,7 +265,7 @@ void all_cache_entry_back_to_disk()
         {
             next = list_next(e);
             struct cache_entry *cache_entry = list_entry(e, struct cache_entry, elem);
-            if (cache_entry->dirty) {
+            if (cache_entry->dirty && !cache_entry->logged) {
                 cache_entry_back_to_disk(cache_entry);
             }
         }
@@ -16,6 +16,7 @@ struct cache_entry
     disk_sector_t sector;
     
     bool dirty;
+    bool logged;        /* In the journal's running set; pinned. */
 };
 
 struct list cache_entry_list;
@@ -30,3 +31,6 @@ void cache_entry_back_to_disk(struct cache_entry *cache_entry);
 void all_cache_entry_back_to_disk();
 void cache_read_to_buffer (disk_sector_t sector, void* buffer);
 void cache_write_from_buffer (disk_sector_t sector, void *buffer);
+void cache_write_at (disk_sector_t sector, const void *buffer, int sector_ofs, int size);
+void cache_copy (disk_sector_t dst, int dst_ofs, disk_sector_t src, int src_ofs, int size);
+void cache_zero (disk_sector_t sector);
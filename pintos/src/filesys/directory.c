@@ -4,6 +4,7 @@
 #include <list.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/thread.h"
 
@@ -23,6 +24,16 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Directory namespace lock.  See directory.h. */
+struct lock dir_lock;
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  lock_init (&dir_lock);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -170,6 +181,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector)
 
   // printf("in dir add \n");
   /* Check that NAME is not in use. */
+  journal_begin ();
   if (lookup (dir, name, NULL, NULL))
     goto done;
 
@@ -196,6 +208,7 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector)
   // inode_close(child_inode);
   
  done:
+  journal_end ();
   return success;
 }
 
@@ -216,6 +229,7 @@ dir_remove (struct dir *dir, const char *name)
 
   // printf("dir sector %d, name %s\n", dir->inode->sector, name);
   /* Find directory entry. */
+  journal_begin ();
   if (!lookup (dir, name, &e, &ofs)) {
     // printf("NO SUCH FILE\n");
     goto done;
@@ -261,6 +275,7 @@ dir_remove (struct dir *dir, const char *name)
     inode_close(inode);
   }
   inode_close (inode);
+  journal_end ();
   return success;
 }
 
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "devices/disk.h"
+#include "threads/synch.h"
 
 /* Maximum length of a file name component.
    This is the traditional UNIX maximum length.
@@ -13,6 +14,13 @@
 
 struct inode;
 
+/* Serializes changes to the directory namespace: path lookup,
+   creating, removing and listing entries.  File data is
+   protected separately by each inode's own lock. */
+extern struct lock dir_lock;
+
+void dir_init (void);
+
 /* Opening and closing directories. */
 bool dir_create (disk_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
@@ -114,6 +114,47 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads into the CNT buffers described by IOV, in order,
+   starting at the file's current position.
+   Returns the total number of bytes read, which may be less
+   than requested if end of file is reached.
+   Advances FILE's position by the number of bytes read. */
+off_t
+file_readv (struct file *file, const struct iovec *iov, int cnt) 
+{
+  off_t bytes_read = inode_readv_at (file->inode, iov, cnt, file->pos);
+  file->pos += bytes_read;
+  return bytes_read;
+}
+
+/* Writes the CNT buffers described by IOV, in order, into FILE
+   starting at the file's current position, growing the file
+   once if needed.
+   Returns the total number of bytes written.
+   Advances FILE's position by the number of bytes written. */
+off_t
+file_writev (struct file *file, const struct iovec *iov, int cnt) 
+{
+  off_t bytes_written = inode_writev_at (file->inode, iov, cnt, file->pos);
+  file->pos += bytes_written;
+  return bytes_written;
+}
+
+/* Copies up to SIZE bytes from IN, starting at its current
+   position, to OUT at its current position, without leaving the
+   kernel.  Returns the number of bytes copied, which may be less
+   than SIZE if end of file is reached in IN or an error occurs.
+   Advances both files' positions by the number of bytes copied. */
+off_t
+file_copy_range (struct file *in, struct file *out, off_t size) 
+{
+  off_t bytes_copied = inode_copy_range (out->inode, out->pos,
+                                         in->inode, in->pos, size);
+  in->pos += bytes_copied;
+  out->pos += bytes_copied;
+  return bytes_copied;
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
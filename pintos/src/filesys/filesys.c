@@ -7,12 +7,24 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "devices/disk.h"
+#include "devices/stripe.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
+/* -stripe: Lay the file system across hd0:1 and hd1:0? */
+bool filesys_striped;
+
+/* Sectors per chunk of the file system's stripe set. */
+#define FILESYS_STRIPE_CHUNK 8
+
+/* With -stripe, the stripe set the file system lives on. */
+static struct stripe *filesys_stripe;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -23,24 +35,71 @@ filesys_init (bool format)
   filesys_disk = disk_get (0, 1);
   if (filesys_disk == NULL)
     PANIC ("hd0:1 (hdb) not present, file system initialization failed");
+  if (filesys_striped)
+    {
+      struct disk *disks[2];
+
+      disks[0] = filesys_disk;
+      disks[1] = disk_get (1, 0);
+      if (disks[1] == NULL)
+        PANIC ("hd1:0 (hdc) not present, cannot stripe file system");
+      filesys_stripe = stripe_create (disks, 2, FILESYS_STRIPE_CHUNK);
+      if (filesys_stripe == NULL)
+        PANIC ("file system stripe set creation failed");
+    }
 
   inode_init ();
+  dir_init ();
   free_map_init ();
   cache_init();
 
+  journal_init (format);
+
   if (format) 
     do_format ();
 
   free_map_open ();
 }
 
+/* Returns the size of the file system device, hd0:1 or the
+   stripe set, in sectors. */
+disk_sector_t
+filesys_size (void)
+{
+  if (filesys_stripe != NULL)
+    return stripe_size (filesys_stripe);
+  return disk_size (filesys_disk);
+}
+
+/* Reads CNT sectors starting at SECTOR of the file system device
+   into BUFFER. */
+void
+filesys_read (disk_sector_t sector, void *buffer, size_t cnt)
+{
+  if (filesys_stripe != NULL)
+    stripe_read (filesys_stripe, sector, buffer, cnt);
+  else
+    disk_read_multiple (filesys_disk, sector, buffer, cnt);
+}
+
+/* Writes CNT sectors starting at SECTOR of the file system device
+   from BUFFER. */
+void
+filesys_write (disk_sector_t sector, const void *buffer, size_t cnt)
+{
+  if (filesys_stripe != NULL)
+    stripe_write (filesys_stripe, sector, buffer, cnt);
+  else
+    disk_write_multiple (filesys_disk, sector, buffer, cnt);
+}
+
 /* Shuts down the file system module, writing any unwritten data
    to disk. */
 void
 filesys_done (void) 
 {
-  all_cache_entry_back_to_disk();
   free_map_close ();
+  journal_done ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -59,6 +118,9 @@ filesys_create (const char *name, off_t initial_size)
   // printf("inode %08x\n", dir_get_inode(dir));
   // printf("name %s\n", file_name);
 
+  /* The inode's sector is allocated in the same transaction as
+     the inode and its directory entry. */
+  journal_begin ();
   bool success = (dir != NULL
                   && free_map_allocate (1, &inode_sector)
                   && inode_create (inode_sector, initial_size)
@@ -66,6 +128,7 @@ filesys_create (const char *name, off_t initial_size)
                   && dir_add (dir, file_name, inode_sector));
   if (!success && inode_sector != 0)
     free_map_release (inode_sector, 1);
+  journal_end ();
   
   // printf("dir open cnt %d\n", inode_open_cnt(dir_get_inode(dir)));
 
@@ -170,6 +233,57 @@ filesys_remove (const char *name)
   return success;
 }
 
+/* Creates NEW_NAME as a copy-on-write clone of the file NAME.
+   The clone shares NAME's data sectors until one of the two
+   files writes them, so this takes time proportional to the
+   file's index rather than its data.
+   Returns true if successful, false otherwise.
+   Fails if NAME does not exist or is a directory, if NEW_NAME
+   already exists, or if internal memory allocation fails. */
+bool
+filesys_clone (const char *name, const char *new_name)
+{
+  struct file *src = filesys_open (name);
+  struct inode *src_inode;
+  disk_sector_t inode_sector = 0;
+  struct dir *dir;
+  char *file_name;
+  bool success;
+
+  if (src == NULL)
+    return false;
+  src_inode = file_get_inode (src);
+  if (inode_isdir (src_inode))
+  {
+    file_close (src);
+    return false;
+  }
+
+  dir = get_dir (new_name);
+  file_name = get_name (new_name);
+  journal_begin ();
+  success = (dir != NULL
+             && free_map_allocate (1, &inode_sector)
+             && inode_clone (inode_sector, src_inode));
+  if (success && !dir_add (dir, file_name, inode_sector))
+  {
+    /* Drop the clone again, which also gives back its shares of
+       the source's sectors. */
+    struct inode *inode = inode_open (inode_sector);
+    inode_remove (inode);
+    inode_close (inode);
+    success = false;
+  }
+  else if (!success && inode_sector != 0)
+    free_map_release (inode_sector, 1);
+  journal_end ();
+
+  dir_close (dir);
+  free (file_name);
+  file_close (src);
+  return success;
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
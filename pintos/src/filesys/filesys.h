@@ -2,19 +2,30 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
 #include "filesys/off_t.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define JOURNAL_SECTOR 2        /* Journal header, then its log. */
 
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
 
+/* -stripe: Lay the file system across hd0:1 and hd1:0? */
+extern bool filesys_striped;
+
 void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+bool filesys_clone (const char *name, const char *new_name);
+
+disk_sector_t filesys_size (void);
+void filesys_read (disk_sector_t, void *, size_t cnt);
+void filesys_write (disk_sector_t, const void *, size_t cnt);
 
 #endif /* filesys/filesys.h */
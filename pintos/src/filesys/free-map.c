@@ -1,22 +1,63 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <hash.h>
+#include <stdint.h>
+#include <stdio.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
+static struct lock free_map_lock;    /* Protects free_map, its file
+                                        and share_table. */
+
+/* The free map file holds the free map followed by the share
+   map, one byte per disk sector giving the sector's owners
+   beyond the first, so that clones still share their sectors
+   after a remount.  share_table caches the nonzero bytes. */
+static off_t share_map_ofs;          /* Offset of the share map. */
+static bool share_map_ok;            /* False if the disk has none. */
+
+/* Most owners beyond the first that a sector can have. */
+#define SHARE_MAX_EXTRA_REFS UINT8_MAX
+
+/* A data sector that more than one cloned inode points to.
+   Sectors with a single owner have no entry. */
+struct share_entry
+  {
+    struct hash_elem elem;
+    disk_sector_t sector;
+    int extra_refs;                  /* Owners beyond the first. */
+  };
+
+/* Sector -> share_entry, for sectors shared by clones. */
+static struct hash share_table;
+
+static unsigned share_hash (const struct hash_elem *, void *);
+static bool share_less (const struct hash_elem *, const struct hash_elem *,
+                        void *);
+static struct share_entry *share_find (disk_sector_t);
+static void share_write (disk_sector_t, int extra_refs);
+static void share_read (void);
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
-  free_map = bitmap_create (disk_size (filesys_disk));
+  free_map = bitmap_create (filesys_size ());
   if (free_map == NULL)
     PANIC ("bitmap creation failed--disk is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  lock_init (&free_map_lock);
+  hash_init (&share_table, share_hash, share_less, NULL);
+  share_map_ofs = bitmap_file_size (free_map);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -26,7 +67,10 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
 {
-  disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  disk_sector_t sector;
+
+  lock_acquire (&free_map_lock);
+  sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
@@ -34,18 +78,170 @@ free_map_allocate (size_t cnt, disk_sector_t *sectorp)
       bitmap_set_multiple (free_map, sector, cnt, false); 
       sector = BITMAP_ERROR;
     }
+  lock_release (&free_map_lock);
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Makes CNT sectors starting at SECTOR available for use.
+   A sector that is still shared with a clone only loses one
+   owner and stays allocated. */
 void
 free_map_release (disk_sector_t sector, size_t cnt)
 {
+  bool changed = false;
+  size_t i;
+
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  for (i = 0; i < cnt; i++)
+    {
+      struct share_entry *s = share_find (sector + i);
+      if (s != NULL)
+        {
+          share_write (sector + i, --s->extra_refs);
+          if (s->extra_refs == 0)
+            {
+              hash_delete (&share_table, &s->elem);
+              free (s);
+            }
+        }
+      else
+        {
+          journal_release (sector + i);
+          bitmap_reset (free_map, sector + i);
+          changed = true;
+        }
+    }
+  if (changed)
+    bitmap_write (free_map, free_map_file);
+  lock_release (&free_map_lock);
+}
+
+/* Adds an owner to allocated SECTOR, which a cloned inode now
+   points to as well.  Returns false if memory runs out, if
+   SECTOR already has as many owners as the share map can count,
+   or if the disk has no share map. */
+bool
+free_map_share (disk_sector_t sector)
+{
+  struct share_entry *s;
+  bool success = true;
+
+  lock_acquire (&free_map_lock);
+  ASSERT (bitmap_test (free_map, sector));
+  s = share_find (sector);
+  if (!share_map_ok)
+    success = false;
+  else if (s != NULL)
+    {
+      if (s->extra_refs < SHARE_MAX_EXTRA_REFS)
+        share_write (sector, ++s->extra_refs);
+      else
+        success = false;
+    }
+  else if ((s = malloc (sizeof *s)) != NULL)
+    {
+      s->sector = sector;
+      s->extra_refs = 1;
+      hash_insert (&share_table, &s->elem);
+      share_write (sector, 1);
+    }
+  else
+    success = false;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Returns true if SECTOR has more than one owner, in which case
+   it must be copied before it is written. */
+bool
+free_map_is_shared (disk_sector_t sector)
+{
+  bool shared;
+
+  lock_acquire (&free_map_lock);
+  shared = share_find (sector) != NULL;
+  lock_release (&free_map_lock);
+  return shared;
+}
+
+/* Returns the share_entry for SECTOR, or a null pointer if
+   SECTOR has a single owner.  free_map_lock must be held. */
+static struct share_entry *
+share_find (disk_sector_t sector)
+{
+  struct share_entry key;
+  struct hash_elem *e;
+
+  key.sector = sector;
+  e = hash_find (&share_table, &key.elem);
+  return e != NULL ? hash_entry (e, struct share_entry, elem) : NULL;
+}
+
+/* Writes SECTOR's EXTRA_REFS to the share map.  Callers that
+   change sharing do so inside a journal transaction, so the
+   write is logged with the rest of the change.  free_map_lock
+   must be held. */
+static void
+share_write (disk_sector_t sector, int extra_refs)
+{
+  uint8_t byte = extra_refs;
+
+  if (free_map_file != NULL)
+    file_write_at (free_map_file, &byte, 1, share_map_ofs + sector);
+}
+
+/* Fills share_table from the share map on disk.  A free map
+   file too short to hold a share map comes from a disk
+   formatted before there was one: cloning is then refused. */
+static void
+share_read (void)
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  uint8_t buf[DISK_SECTOR_SIZE];
+  size_t ofs, i;
+
+  share_map_ok = (inode_length (file_get_inode (free_map_file))
+                  >= share_map_ofs + (off_t) sector_cnt);
+  if (!share_map_ok)
+    {
+      printf ("free map: no share map on disk, clones are disabled\n");
+      return;
+    }
+
+  for (ofs = 0; ofs < sector_cnt; ofs += sizeof buf)
+    {
+      size_t cnt = sector_cnt - ofs < sizeof buf ? sector_cnt - ofs : sizeof buf;
+      if (file_read_at (free_map_file, buf, cnt, share_map_ofs + ofs)
+          != (off_t) cnt)
+        PANIC ("can't read share map");
+      for (i = 0; i < cnt; i++)
+        if (buf[i] != 0)
+          {
+            struct share_entry *s = malloc (sizeof *s);
+            if (s == NULL)
+              PANIC ("can't allocate share map entry");
+            s->sector = ofs + i;
+            s->extra_refs = buf[i];
+            hash_insert (&share_table, &s->elem);
+          }
+    }
+}
+
+static unsigned
+share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct share_entry, elem)->sector);
+}
+
+static bool
+share_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return hash_entry (a, struct share_entry, elem)->sector
+         < hash_entry (b, struct share_entry, elem)->sector;
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -62,6 +258,7 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file)) 
     PANIC ("can't read free map");
+  share_read ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -72,13 +269,15 @@ free_map_close (void)
 }
 
 /* Creates a new free map file on disk and writes the free map to
-   it. */
+   it.  The share map after it starts out zeroed. */
 void
 free_map_create (void) 
 {
   /* Create inode. */
-  if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+  if (!inode_create (FREE_MAP_SECTOR,
+                     share_map_ofs + bitmap_size (free_map)))
     PANIC ("free map creation failed");
+  share_map_ok = true;
 
   /* Write bitmap to file. */
   free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
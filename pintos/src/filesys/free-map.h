@@ -13,5 +13,7 @@ void free_map_close (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
 void free_map_release (disk_sector_t, size_t);
+bool free_map_share (disk_sector_t);
+bool free_map_is_shared (disk_sector_t);
 
 #endif /* filesys/free-map.h */
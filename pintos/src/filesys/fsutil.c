@@ -1,5 +1,6 @@
 #include "filesys/fsutil.h"
 #include <debug.h>
+#include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,6 +12,12 @@
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
 
+/* Pages in the buffer that fsutil_put() and fsutil_get() move
+   data through, so that each scratch disk transfer is one
+   multi-sector command. */
+#define TRANSFER_PAGES 16
+#define TRANSFER_SECTORS (TRANSFER_PAGES * PGSIZE / DISK_SECTOR_SIZE)
+
 /* List files in the root directory. */
 void
 fsutil_ls (char **argv UNUSED) 
@@ -77,7 +84,11 @@ fsutil_rm (char **argv)
    The first call to this function will read starting at the
    beginning of the scratch disk.  Later calls advance across the
    disk.  This disk position is independent of that used for
-   fsutil_get(), so all `put's should precede all `get's. */
+   fsutil_get(), so all `put's should precede all `get's.
+
+   The file is created at its full size, so all of its sectors
+   are allocated once, up front, and the copy itself only
+   overwrites them, TRANSFER_SECTORS at a time. */
 void
 fsutil_put (char **argv) 
 {
@@ -92,11 +103,13 @@ fsutil_put (char **argv)
   printf ("Putting '%s' into the file system...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (DISK_SECTOR_SIZE);
+  buffer = palloc_get_multiple (0, TRANSFER_PAGES);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
   /* Open source disk and read file size. */
+  if (filesys_striped)
+    PANIC ("scratch disk (hdc or hd1:0) holds part of the file system");
   src = disk_get (1, 0);
   if (src == NULL)
     PANIC ("couldn't open source disk (hdc or hd1:0)");
@@ -121,8 +134,20 @@ fsutil_put (char **argv)
   /* Do copy. */
   while (size > 0)
     {
-      int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-      disk_read (src, sector++, buffer);
+      size_t sector_cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+      int chunk_size;
+
+      if (sector_cnt > TRANSFER_SECTORS)
+        sector_cnt = TRANSFER_SECTORS;
+      chunk_size = sector_cnt * DISK_SECTOR_SIZE;
+      if (chunk_size > size)
+        chunk_size = size;
+
+      if (sector + sector_cnt > disk_size (src))
+        PANIC ("%s: scratch disk ends with %"PROTd" bytes unread",
+               file_name, size);
+      disk_read_multiple (src, sector, buffer, sector_cnt);
+      sector += sector_cnt;
       if (file_write (dst, buffer, chunk_size) != chunk_size)
         PANIC ("%s: write failed with %"PROTd" bytes unwritten",
                file_name, size);
@@ -131,7 +156,7 @@ fsutil_put (char **argv)
 
   /* Finish up. */
   file_close (dst);
-  free (buffer);
+  palloc_free_multiple (buffer, TRANSFER_PAGES);
 }
 
 /* Copies file FILE_NAME from the file system to the scratch disk.
@@ -159,7 +184,7 @@ fsutil_get (char **argv)
   printf ("Getting '%s' from the file system...\n", file_name);
 
   /* Allocate buffer. */
-  buffer = malloc (DISK_SECTOR_SIZE);
+  buffer = palloc_get_multiple (0, TRANSFER_PAGES);
   if (buffer == NULL)
     PANIC ("couldn't allocate buffer");
 
@@ -170,6 +195,8 @@ fsutil_get (char **argv)
   size = file_length (src);
 
   /* Open target disk. */
+  if (filesys_striped)
+    PANIC ("scratch disk (hdc or hd1:0) holds part of the file system");
   dst = disk_get (1, 0);
   if (dst == NULL)
     PANIC ("couldn't open target disk (hdc or hd1:0)");
@@ -183,17 +210,27 @@ fsutil_get (char **argv)
   /* Do copy. */
   while (size > 0) 
     {
-      int chunk_size = size > DISK_SECTOR_SIZE ? DISK_SECTOR_SIZE : size;
-      if (sector >= disk_size (dst))
+      size_t sector_cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+      int chunk_size;
+
+      if (sector_cnt > TRANSFER_SECTORS)
+        sector_cnt = TRANSFER_SECTORS;
+      chunk_size = sector_cnt * DISK_SECTOR_SIZE;
+      if (chunk_size > size)
+        chunk_size = size;
+
+      if (sector + sector_cnt > disk_size (dst))
         PANIC ("%s: out of space on scratch disk", file_name);
       if (file_read (src, buffer, chunk_size) != chunk_size)
         PANIC ("%s: read failed with %"PROTd" bytes unread", file_name, size);
-      memset (buffer + chunk_size, 0, DISK_SECTOR_SIZE - chunk_size);
-      disk_write (dst, sector++, buffer);
+      memset (buffer + chunk_size, 0,
+              sector_cnt * DISK_SECTOR_SIZE - chunk_size);
+      disk_write_multiple (dst, sector, buffer, sector_cnt);
+      sector += sector_cnt;
       size -= chunk_size;
     }
 
   /* Finish up. */
   file_close (src);
-  free (buffer);
+  palloc_free_multiple (buffer, TRANSFER_PAGES);
 }
@@ -6,6 +6,7 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 
 
@@ -59,6 +60,32 @@ bytes_to_sectors (off_t size)
   
 //   };
 
+/* Returns the slot in DATA's index that holds the sector number
+   of data sector IDX. */
+static disk_sector_t *
+sector_slot (const struct inode_disk *data, size_t idx)
+{
+  int row, col;
+  if(idx < DIRECT_BLOCK_SIZE)
+  {
+    return (disk_sector_t *) &data->direct_index[idx];
+  }
+  else if(idx < DIRECT_BLOCK_SIZE + INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR)
+  {
+    idx -= DIRECT_BLOCK_SIZE;
+    row = idx / PTR_NUMBER_PER_SECTOR;
+    col = idx % PTR_NUMBER_PER_SECTOR;
+    return &data->indirect_index[row][col];
+  }
+  else
+  {
+    idx -= DIRECT_BLOCK_SIZE + INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR;
+    row = idx / PTR_NUMBER_PER_SECTOR;
+    col = idx % PTR_NUMBER_PER_SECTOR;
+    return &data->double_indirect_index[row][col];
+  }
+}
+
 /* Returns the disk sector that contains byte offset POS within
    INODE.
    Returns -1 if INODE does not contain data for a byte at offset
@@ -66,51 +93,303 @@ bytes_to_sectors (off_t size)
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) 
 {
-  int row, col;
   ASSERT (inode != NULL);
   if (pos >= 0 && pos < inode->data.length)
+    return *sector_slot (&inode->data, pos / DISK_SECTOR_SIZE);
+  else
+    return -1;
+}
+
+static bool store_slot (struct inode *, size_t idx);
+
+/* Like byte_to_sector(), but first gives INODE a private copy of
+   the sector if it is still shared with a clone, so that the
+   caller may write it.  The new slot goes to disk in the same
+   transaction as the share map change.  Returns -1 if POS is out
+   of range or no sector is free for the copy.  INODE's lock must
+   be held exclusively if INODE is a clone. */
+static disk_sector_t
+byte_to_sector_for_write (struct inode *inode, off_t pos)
+{
+  size_t idx = pos / DISK_SECTOR_SIZE;
+  disk_sector_t *slot, old, copy;
+
+  if (pos < 0 || pos >= inode->data.length)
+    return -1;
+  slot = sector_slot (&inode->data, idx);
+  if (!inode->data.cow || !free_map_is_shared (*slot))
+    return *slot;
+
+  journal_begin ();
+  old = *slot;
+  if (!free_map_allocate (1, &copy))
+    copy = -1;
+  else
+    {
+      cache_copy (copy, 0, old, 0, DISK_SECTOR_SIZE);
+      *slot = copy;
+      if (store_slot (inode, idx))
+        free_map_release (old, 1);
+      else
+        {
+          *slot = old;
+          free_map_release (copy, 1);
+          copy = -1;
+        }
+    }
+  journal_end ();
+  return copy;
+}
+
+/* Number of indirect_index[] rows that a file of SECTORS data
+   sectors uses. */
+static size_t
+indirect_rows (size_t sectors)
+{
+  if (sectors <= DIRECT_BLOCK_SIZE)
+    return 0;
+  sectors -= DIRECT_BLOCK_SIZE;
+  if (sectors > INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR)
+    sectors = INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR;
+  return DIV_ROUND_UP (sectors, PTR_NUMBER_PER_SECTOR);
+}
+
+/* Number of double_indirect_index rows that a file of SECTORS
+   data sectors uses. */
+static size_t
+double_indirect_rows (size_t sectors)
+{
+  if (sectors <= DIRECT_BLOCK_SIZE + INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR)
+    return 0;
+  return DIV_ROUND_UP (sectors - DIRECT_BLOCK_SIZE
+                       - INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR,
+                       PTR_NUMBER_PER_SECTOR);
+}
+
+/* Writes the index rows that DATA uses to disk, giving each one
+   a sector first if it has none yet, and records those sectors
+   in DATA, so that DATA itself can then be written out and read
+   back with load_index().  Returns false if the free map runs
+   out of sectors. */
+static bool
+store_index (struct inode_disk *data)
+{
+  size_t rows = indirect_rows (data->sectors);
+  disk_sector_t *top;
+  bool success = true;
+  size_t i;
+
+  for (i = 0; i < rows; i++)
+  {
+    if (data->indirect_sector[i] == 0
+        && !free_map_allocate (1, &data->indirect_sector[i]))
+      return false;
+    cache_write_from_buffer (data->indirect_sector[i], data->indirect_index[i]);
+  }
+
+  rows = double_indirect_rows (data->sectors);
+  if (rows == 0)
+    return true;
+
+  /* The double indirect sector lists the sectors of its rows. */
+  top = calloc (PTR_NUMBER_PER_SECTOR, sizeof *top);
+  if (top == NULL)
+    return false;
+  if (data->double_indirect_sector != 0)
+    cache_read_to_buffer (data->double_indirect_sector, top);
+  else if (!free_map_allocate (1, &data->double_indirect_sector))
+    success = false;
+
+  for (i = 0; success && i < rows; i++)
   {
-    if(pos < DIRECT_BLOCK_SIZE * DISK_SECTOR_SIZE)
+    if (top[i] == 0 && !free_map_allocate (1, &top[i]))
+      success = false;
+    else
+      cache_write_from_buffer (top[i], data->double_indirect_index[i]);
+  }
+
+  if (data->double_indirect_sector != 0)
+    cache_write_from_buffer (data->double_indirect_sector, top);
+  free (top);
+  return success;
+}
+
+/* Writes the part of INODE's index that holds the slot of data
+   sector IDX to disk: INODE's own sector for a direct sector,
+   otherwise the index row's sector.  If the row has no sector
+   yet, the whole index is stored and INODE written after it.
+   Returns false if memory or the free map runs out. */
+static bool
+store_slot (struct inode *inode, size_t idx)
+{
+  struct inode_disk *data = &inode->data;
+  disk_sector_t *top, row_sector;
+  size_t row;
+
+  if (idx < DIRECT_BLOCK_SIZE)
+  {
+    cache_write_from_buffer (inode->sector, data);
+    return true;
+  }
+  idx -= DIRECT_BLOCK_SIZE;
+  if (idx < INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR)
+  {
+    row = idx / PTR_NUMBER_PER_SECTOR;
+    if (data->indirect_sector[row] != 0)
     {
-      return inode->data.direct_index[pos/DISK_SECTOR_SIZE];
+      cache_write_from_buffer (data->indirect_sector[row], data->indirect_index[row]);
+      return true;
     }
-    else if(pos < (DIRECT_BLOCK_SIZE * DISK_SECTOR_SIZE) + (INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR * DISK_SECTOR_SIZE))
+  }
+  else if (data->double_indirect_sector != 0)
+  {
+    row = (idx - INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR) / PTR_NUMBER_PER_SECTOR;
+    top = calloc (PTR_NUMBER_PER_SECTOR, sizeof *top);
+    if (top == NULL)
+      return false;
+    cache_read_to_buffer (data->double_indirect_sector, top);
+    row_sector = top[row];
+    free (top);
+    if (row_sector != 0)
     {
-      pos -= DIRECT_BLOCK_SIZE * DISK_SECTOR_SIZE;
-      row = (pos/DISK_SECTOR_SIZE) / PTR_NUMBER_PER_SECTOR;
-      col = (pos/DISK_SECTOR_SIZE) % PTR_NUMBER_PER_SECTOR;
-      return inode->data.indirect_index[row][col];
+      cache_write_from_buffer (row_sector, data->double_indirect_index[row]);
+      return true;
     }
-    else
+  }
+
+  if (!store_index (data))
+    return false;
+  cache_write_from_buffer (inode->sector, data);
+  return true;
+}
+
+/* Rebuilds the in-memory index rows of DATA, just read from
+   disk, from the sectors that store_index() put them in.  Rows
+   are allocated the same way inode_create() allocates them. */
+static void
+load_index (struct inode_disk *data)
+{
+  size_t rows, i;
+
+  for (i = 0; i < INDIRECT_BLOCK_SIZE; i++)
+    data->indirect_index[i] = NULL;
+  data->double_indirect_index = NULL;
+
+  if (data->sectors > DIRECT_BLOCK_SIZE)
+  {
+    rows = indirect_rows (data->sectors);
+    for (i = 0; i < INDIRECT_BLOCK_SIZE; i++)
     {
-      pos -= (DIRECT_BLOCK_SIZE * DISK_SECTOR_SIZE) + (INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR * DISK_SECTOR_SIZE);
-      row = (pos/DISK_SECTOR_SIZE) / PTR_NUMBER_PER_SECTOR;
-      col = (pos/DISK_SECTOR_SIZE) % PTR_NUMBER_PER_SECTOR;
-      return inode->data.double_indirect_index[row][col];
+      data->indirect_index[i] = calloc (PTR_NUMBER_PER_SECTOR, sizeof (disk_sector_t));
+      if (i < rows && data->indirect_sector[i] != 0)
+        cache_read_to_buffer (data->indirect_sector[i], data->indirect_index[i]);
     }
   }
-  else
-    return -1;
+
+  if (data->sectors > DIRECT_BLOCK_SIZE + PTR_NUMBER_PER_SECTOR)
+  {
+    disk_sector_t *top = NULL;
+
+    rows = double_indirect_rows (data->sectors);
+    if (rows > 0 && data->double_indirect_sector != 0)
+    {
+      top = malloc (DISK_SECTOR_SIZE);
+      cache_read_to_buffer (data->double_indirect_sector, top);
+    }
+
+    data->double_indirect_index = calloc (PTR_NUMBER_PER_SECTOR, sizeof (disk_sector_t *));
+    for (i = 0; i < PTR_NUMBER_PER_SECTOR; i++)
+    {
+      data->double_indirect_index[i] = calloc (PTR_NUMBER_PER_SECTOR, sizeof (disk_sector_t));
+      if (top != NULL && i < rows && top[i] != 0)
+        cache_read_to_buffer (top[i], data->double_indirect_index[i]);
+    }
+    free (top);
+  }
+}
+
+/* Frees the in-memory index rows of DATA. */
+static void
+free_index (struct inode_disk *data)
+{
+  size_t i;
+
+  for (i = 0; i < INDIRECT_BLOCK_SIZE; i++)
+  {
+    free (data->indirect_index[i]);
+    data->indirect_index[i] = NULL;
+  }
+  if (data->double_indirect_index != NULL)
+  {
+    for (i = 0; i < PTR_NUMBER_PER_SECTOR; i++)
+      free (data->double_indirect_index[i]);
+    free (data->double_indirect_index);
+    data->double_indirect_index = NULL;
+  }
+}
+
+/* Returns the sectors that DATA's index rows are stored in to
+   the free map. */
+static void
+release_index (struct inode_disk *data)
+{
+  size_t i;
+
+  for (i = 0; i < INDIRECT_BLOCK_SIZE; i++)
+    if (data->indirect_sector[i] != 0)
+      free_map_release (data->indirect_sector[i], 1);
+
+  if (data->double_indirect_sector != 0)
+  {
+    disk_sector_t *top = malloc (DISK_SECTOR_SIZE);
+    if (top != NULL)
+    {
+      cache_read_to_buffer (data->double_indirect_sector, top);
+      for (i = 0; i < PTR_NUMBER_PER_SECTOR; i++)
+        if (top[i] != 0)
+          free_map_release (top[i], 1);
+      free (top);
+    }
+    free_map_release (data->double_indirect_sector, 1);
+  }
 }
 
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the open_cnt of its members. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
 }
 
+static bool do_inode_create (disk_sector_t sector, off_t length);
+
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   disk.
+   disk, as one journal transaction.
    Returns true if successful.
    Returns false if memory or disk allocation fails. */
 bool
 inode_create (disk_sector_t sector, off_t length)
+{
+  bool success;
+
+  journal_begin ();
+  success = do_inode_create (sector, length);
+  journal_end ();
+  return success;
+}
+
+/* Does the work of inode_create(). */
+static bool
+do_inode_create (disk_sector_t sector, off_t length)
 {
   // printf("____DEBUG____length %d \n", length);
   struct inode_disk *disk_inode = NULL;
@@ -155,8 +434,7 @@ inode_create (disk_sector_t sector, off_t length)
           if(free_map_allocate (1, &disk_inode->direct_index[i]))
           {
             // printf("sector number %d \n", disk_inode->direct_index[i]);
-            static char zeros[DISK_SECTOR_SIZE];
-            cache_write_from_buffer(disk_inode->direct_index[i], zeros);
+            cache_zero(disk_inode->direct_index[i]);
           }
           else
             return success; // fail 
@@ -173,8 +451,7 @@ inode_create (disk_sector_t sector, off_t length)
           col = i%PTR_NUMBER_PER_SECTOR;
           if(free_map_allocate (1, &disk_inode->indirect_index[row][col]))
           {
-            static char zeros[DISK_SECTOR_SIZE];
-            cache_write_from_buffer(disk_inode->indirect_index[row][col], zeros);
+            cache_zero(disk_inode->indirect_index[row][col]);
           }
           else
             return success; // fail 
@@ -193,16 +470,16 @@ inode_create (disk_sector_t sector, off_t length)
           col = i%PTR_NUMBER_PER_SECTOR;
           if(free_map_allocate (1, &disk_inode->double_indirect_index[row][col]))
           {
-            static char zeros[DISK_SECTOR_SIZE];
-            cache_write_from_buffer(disk_inode->double_indirect_index[row][col], zeros);
+            cache_zero(disk_inode->double_indirect_index[row][col]);
           }
           else {
             return success; // fail 
           }
         }
       }
-      success = true;
+      success = store_index (disk_inode);
       cache_write_from_buffer(sector, disk_inode);
+      free_index (disk_inode);
       free (disk_inode);
 
 
@@ -226,6 +503,87 @@ inode_create (disk_sector_t sector, off_t length)
   return success;
 }
 
+/* Writes a new inode to SECTOR that shares all of SRC's data
+   sectors instead of copying them.  Each shared sector gains an
+   owner in the free map, and whichever of the two inodes writes
+   it first gets a private copy in byte_to_sector_for_write().
+   Returns true if successful, false if memory runs out. */
+bool
+inode_clone (disk_sector_t sector, struct inode *src)
+{
+  struct inode_disk *disk_inode;
+  size_t i;
+  bool success = false;
+
+  disk_inode = calloc (1, sizeof *disk_inode);
+  if (disk_inode == NULL)
+    return false;
+
+  /* Hold off writers so that the clone is a consistent copy.
+     The new owner counts go to the share map in the same
+     transaction as the clone's inode. */
+  journal_begin ();
+  rw_lock_acquire_write (&src->rw_lock);
+  disk_inode->length = src->data.length;
+  disk_inode->magic = INODE_MAGIC;
+  disk_inode->sectors = src->data.sectors;
+  disk_inode->cow = 1;
+
+  /* Index blocks are private to each inode; only data sectors
+     are shared. */
+  for (i = 0; i < INDIRECT_BLOCK_SIZE; i++)
+    if (src->data.indirect_index[i] != NULL)
+    {
+      disk_inode->indirect_index[i] = malloc (PTR_NUMBER_PER_SECTOR * sizeof (disk_sector_t));
+      if (disk_inode->indirect_index[i] == NULL)
+        goto done;
+      memcpy (disk_inode->indirect_index[i], src->data.indirect_index[i],
+              PTR_NUMBER_PER_SECTOR * sizeof (disk_sector_t));
+    }
+  if (src->data.double_indirect_index != NULL)
+  {
+    disk_inode->double_indirect_index = calloc (1, PTR_NUMBER_PER_SECTOR * sizeof (disk_sector_t *));
+    if (disk_inode->double_indirect_index == NULL)
+      goto done;
+    for (i = 0; i < PTR_NUMBER_PER_SECTOR; i++)
+    {
+      disk_inode->double_indirect_index[i] = malloc (PTR_NUMBER_PER_SECTOR * sizeof (disk_sector_t));
+      if (disk_inode->double_indirect_index[i] == NULL)
+        goto done;
+      memcpy (disk_inode->double_indirect_index[i], src->data.double_indirect_index[i],
+              PTR_NUMBER_PER_SECTOR * sizeof (disk_sector_t));
+    }
+  }
+
+  if (!store_index (disk_inode))
+    goto done;
+
+  for (i = 0; i < disk_inode->sectors; i++)
+    if (!free_map_share (*sector_slot (disk_inode, i)))
+    {
+      while (i-- > 0)
+        free_map_release (*sector_slot (disk_inode, i), 1);
+      goto done;
+    }
+
+  /* The source's cow flag goes to disk with the owner counts,
+     or the source could come back writing shared sectors in
+     place. */
+  src->data.cow = 1;
+  cache_write_from_buffer (src->sector, &src->data);
+  cache_write_from_buffer (sector, disk_inode);
+  success = true;
+
+ done:
+  rw_lock_release_write (&src->rw_lock);
+  if (!success)
+    release_index (disk_inode);
+  journal_end ();
+  free_index (disk_inode);
+  free (disk_inode);
+  return success;
+}
+
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
    Returns a null pointer if memory allocation fails. */
@@ -236,13 +594,15 @@ inode_open (disk_sector_t sector)
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
           // printf("____DEBUG______after inode reopen, inode is %08x sector is %d\n", inode, sector);
           return inode; 
         }
@@ -252,6 +612,7 @@ inode_open (disk_sector_t sector)
   inode = malloc (sizeof *inode);
   if (inode == NULL) {
     // printf("____DEBUG______inode is NULL, malloc failed");
+    lock_release (&open_inodes_lock);
     return NULL;
   }
   /* Initialize. */
@@ -262,10 +623,17 @@ inode_open (disk_sector_t sector)
   inode->deny_write_cnt = 0;
   inode->removed = false;
   inode->isdir = 0;
+  rw_lock_init (&inode->rw_lock);
   // printf("here?!\n");
 
+  /* Read the inode while still holding open_inodes_lock, so that
+     a concurrent opener never sees it half-initialized. */
   // disk_read (filesys_disk, inode->sector, &inode->data);
   cache_read_to_buffer(inode->sector, &inode->data);
+  load_index (&inode->data);
+  inode->isdir = inode->data.isdir != 0;
+  inode->parent = inode->data.parent;
+  lock_release (&open_inodes_lock);
   // printf("++++DEBUG+++++\n");
   // hex_dump(&inode->data, &inode->data, 4, 0);
   // printf("direct data %d\n", inode->data.direct_index[0]);
@@ -278,7 +646,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -289,15 +661,18 @@ inode_get(disk_sector_t sector)
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
+          lock_release (&open_inodes_lock);
           return inode; 
         }
     }
+  lock_release (&open_inodes_lock);
 
   return NULL;
 }
@@ -333,14 +708,21 @@ inode_close (struct inode *inode)
     double_indirect_sectors = sectors - DIRECT_BLOCK_SIZE - INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR;
 
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      lock_release (&open_inodes_lock);
  
+      /* Freeing the blocks or writing back the inode is one
+         journal transaction. */
+      journal_begin ();
+
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          release_index (&inode->data);
           free_map_release (inode->sector, 1);
           for(i=0; i<direct_sectors; i++)
             free_map_release(inode->data.direct_index[i], 1);
@@ -375,10 +757,14 @@ inode_close (struct inode *inode)
       else
       {
         // remove 하지 않는데 close하는 경우
+        store_index (&inode->data);
         cache_write_from_buffer(inode->sector, &inode->data);
+        free_index (&inode->data);
       } 
+      journal_end ();
     }
-  all_cache_entry_back_to_disk();
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -390,15 +776,52 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+static off_t read_at (struct inode *, uint8_t *, off_t size, off_t offset);
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset) 
+{
+  off_t bytes_read;
+
+  rw_lock_acquire_read (&inode->rw_lock);
+  bytes_read = read_at (inode, buffer, size, offset);
+  rw_lock_release_read (&inode->rw_lock);
+  return bytes_read;
+}
+
+/* Reads into the CNT buffers described by IOV in order, starting
+   at OFFSET in INODE, under a single acquisition of INODE's
+   lock.  Returns the total number of bytes read, which is short
+   only at end of file or on error. */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int cnt,
+                off_t offset)
+{
+  off_t bytes_read = 0;
+  int i;
+
+  rw_lock_acquire_read (&inode->rw_lock);
+  for (i = 0; i < cnt; i++)
+    {
+      off_t chunk = read_at (inode, iov[i].iov_base, iov[i].iov_len,
+                             offset + bytes_read);
+      bytes_read += chunk;
+      if (chunk < (off_t) iov[i].iov_len)
+        break;
+    }
+  rw_lock_release_read (&inode->rw_lock);
+  return bytes_read;
+}
+
+/* Does the work of inode_read_at() with INODE's lock held. */
+static off_t
+read_at (struct inode *inode, uint8_t *buffer, off_t size, off_t offset) 
 {
   // printf("____DEBUG_____ start inode_read_at\n");
   // printf("____DEBUG____initial size : %d, offset : %d, inode_length : %d\n", size, offset, inode->data.length);
-  uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
@@ -469,31 +892,77 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   return bytes_read;
 }
 
-/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
-   Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
-off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-                off_t offset) 
+static off_t write_at (struct inode *, const uint8_t *, off_t size,
+                       off_t offset);
+
+/* Takes INODE's lock for a write that ends at byte END: shared if
+   the write stays in bounds, exclusive if it grows the file or
+   INODE is a clone whose shared sectors may need copying.  The
+   clone flag is checked again once the lock is held, since
+   inode_clone() may have set it in the meantime.  Returns true if
+   the lock was taken exclusively. */
+static bool
+write_lock_acquire (struct inode *inode, off_t end)
 {
-  const uint8_t *buffer = buffer_;
-  off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
-  int i, row, col;
+  if (end <= inode_length (inode) && !inode->data.cow)
+    {
+      rw_lock_acquire_read (&inode->rw_lock);
+      if (!inode->data.cow)
+        return false;
+      rw_lock_release_read (&inode->rw_lock);
+    }
+  rw_lock_acquire_write (&inode->rw_lock);
+  return true;
+}
 
-  if (inode->deny_write_cnt)
-    return 0;
+/* Releases INODE's lock taken by write_lock_acquire(). */
+static void
+write_lock_release (struct inode *inode, bool exclusive)
+{
+  if (exclusive)
+    rw_lock_release_write (&inode->rw_lock);
+  else
+    rw_lock_release_read (&inode->rw_lock);
+}
+
+static bool do_inode_grow (struct inode *, off_t length);
+
+/* Extends INODE so that it is at least LENGTH bytes long,
+   allocating and zeroing whatever sectors that takes.  Returns
+   false if the free map runs out of sectors.  The caller must
+   hold INODE's lock exclusively if LENGTH is past end of file.
+   Allocation is one journal transaction. */
+static bool
+inode_grow (struct inode *inode, off_t length)
+{
+  bool success;
 
-  size_t add_sectors = bytes_to_sectors(offset + size) > inode->data.sectors ? bytes_to_sectors(offset + size) - inode->data.sectors : 0;
+  if (bytes_to_sectors (length) <= inode->data.sectors)
+    {
+      if (length > inode->data.length)
+        inode->data.length = length;
+      return true;
+    }
+
+  journal_begin ();
+  success = do_inode_grow (inode, length);
+  journal_end ();
+  return success;
+}
+
+/* Does the work of inode_grow(). */
+static bool
+do_inode_grow (struct inode *inode, off_t length)
+{
+  int i, row, col;
+
+  size_t add_sectors = bytes_to_sectors(length) > inode->data.sectors ? bytes_to_sectors(length) - inode->data.sectors : 0;
 
   size_t add_direct_sectors = 0;
   size_t add_indirect_sectors = 0;
   size_t add_double_indirect_sectors = 0;
 
-  // printf("offset %d, size %d\n", offset, size);
-  // printf("full sector %d, curr sector %d, add_sectors %d, inode length %d\n", bytes_to_sectors(offset + size), inode->data.sectors, add_sectors, inode->data.length);
+  // printf("full sector %d, curr sector %d, add_sectors %d, inode length %d\n", bytes_to_sectors(length), inode->data.sectors, add_sectors, inode->data.length);
 
   if(add_sectors > 0)
   {
@@ -505,11 +974,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       {
         if(free_map_allocate (1, &inode->data.direct_index[inode->data.sectors + i]))
         {
-          static char zeros[DISK_SECTOR_SIZE];
-          cache_write_from_buffer(inode->data.direct_index[inode->data.sectors + i], zeros);
+          cache_zero(inode->data.direct_index[inode->data.sectors + i]);
         }
         else
-          return 0; // fail
+          return false; // fail
       }
       if(add_sectors > DIRECT_BLOCK_SIZE - inode->data.sectors)
       {
@@ -524,11 +992,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           col = i%PTR_NUMBER_PER_SECTOR;
           if(free_map_allocate (1, &inode->data.indirect_index[row][col]))
           {
-            static char zeros[DISK_SECTOR_SIZE];
-            cache_write_from_buffer(inode->data.indirect_index[row][col], zeros);
+            cache_zero(inode->data.indirect_index[row][col]);
           }
           else
-            return 0; // fail
+            return false; // fail
         }
         if(add_sectors > DIRECT_BLOCK_SIZE + INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR - inode->data.sectors)
         {
@@ -545,11 +1012,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
             col = i%PTR_NUMBER_PER_SECTOR;
             if(free_map_allocate (1, &inode->data.double_indirect_index[row][col]))
             {
-              static char zeros[DISK_SECTOR_SIZE];
-              cache_write_from_buffer(inode->data.double_indirect_index[row][col], zeros);
+              cache_zero(inode->data.double_indirect_index[row][col]);
             }
             else
-              return 0; // fail 
+              return false; // fail 
           }
         }
       }
@@ -564,11 +1030,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
         col = (inode->data.sectors - DIRECT_BLOCK_SIZE + i)%PTR_NUMBER_PER_SECTOR; 
         if(free_map_allocate (1, &inode->data.indirect_index[row][col]))
         {
-          static char zeros[DISK_SECTOR_SIZE];
-          cache_write_from_buffer(inode->data.indirect_index[row][col], zeros);
+          cache_zero(inode->data.indirect_index[row][col]);
         }
         else
-          return 0; // fail
+          return false; // fail
       }
       if(DIRECT_BLOCK_SIZE + INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR - inode->data.sectors < add_sectors)
       {
@@ -585,11 +1050,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           col = i%PTR_NUMBER_PER_SECTOR;
           if(free_map_allocate (1, &inode->data.double_indirect_index[row][col]))
           {
-            static char zeros[DISK_SECTOR_SIZE];
-            cache_write_from_buffer(inode->data.double_indirect_index[row][col], zeros);
+            cache_zero(inode->data.double_indirect_index[row][col]);
           }
           else
-            return 0; // fail 
+            return false; // fail 
         }
       }
     }
@@ -605,28 +1069,96 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
         col = (i + inode->data.sectors - DIRECT_BLOCK_SIZE - INDIRECT_BLOCK_SIZE * PTR_NUMBER_PER_SECTOR)%PTR_NUMBER_PER_SECTOR;
         if(free_map_allocate (1, &inode->data.double_indirect_index[row][col]))
         {
-          static char zeros[DISK_SECTOR_SIZE];
-          cache_write_from_buffer(inode->data.double_indirect_index[row][col], zeros);
+          cache_zero(inode->data.double_indirect_index[row][col]);
         }
         else
-          return 0; // fail 
+          return false; // fail 
       }
     }
     inode->data.sectors += add_sectors;
-    inode->data.length = offset + size;
   }
 
+  if(length > inode->data.length)
+    inode->data.length = length;
+  return true;
+}
 
-  // printf("offset + size %d, inode length %d, add_sectors %d\n", offset+size, inode->data.length, add_sectors);
-  if(offset + size > inode->data.length && add_sectors <= 0)
-  {
-    inode->data.length = offset + size;
-  }
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+   Returns the number of bytes actually written, which may be
+   less than SIZE if an error occurs.  A write past end of file
+   extends the inode.
+
+   Writes that stay within the current length only hold INODE's
+   lock shared, so they run alongside readers; a write that
+   grows the file, or that may have to copy sectors shared with
+   a clone, holds it exclusively.  Since the length never
+   shrinks while the inode is open, a write that is in bounds
+   when checked stays in bounds. */
+off_t
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+                off_t offset) 
+{
+  off_t bytes_written;
+  bool exclusive;
+
+  if (inode->deny_write_cnt)
+    return 0;
+
+  exclusive = write_lock_acquire (inode, offset + size);
+  bytes_written = write_at (inode, buffer, size, offset);
+  write_lock_release (inode, exclusive);
+  return bytes_written;
+}
+
+/* Writes the CNT buffers described by IOV to INODE in order,
+   starting at OFFSET.  The inode's lock is taken once, and the
+   file is grown to its final length in one step before any data
+   is copied.  Returns the total number of bytes written. */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int cnt,
+                 off_t offset)
+{
+  off_t size = 0;
+  off_t bytes_written = 0;
+  bool exclusive;
+  int i;
+
+  if (inode->deny_write_cnt)
+    return 0;
+
+  for (i = 0; i < cnt; i++)
+    size += iov[i].iov_len;
+
+  exclusive = write_lock_acquire (inode, offset + size);
+
+  if (inode_grow (inode, offset + size))
+    for (i = 0; i < cnt; i++)
+      {
+        off_t chunk = write_at (inode, iov[i].iov_base, iov[i].iov_len,
+                                offset + bytes_written);
+        bytes_written += chunk;
+        if (chunk < (off_t) iov[i].iov_len)
+          break;
+      }
+
+  write_lock_release (inode, exclusive);
+  return bytes_written;
+}
+
+/* Does the work of inode_write_at() with INODE's lock held. */
+static off_t
+write_at (struct inode *inode, const uint8_t *buffer, off_t size,
+          off_t offset) 
+{
+  off_t bytes_written = 0;
+
+  if (!inode_grow (inode, offset + size))
+    return 0; // fail
 
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset);
+      disk_sector_t sector_idx = byte_to_sector_for_write (inode, offset);
       int sector_ofs = offset % DISK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -636,7 +1168,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 
       /* Number of bytes to actually write into this sector. */
       int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
+      if (chunk_size <= 0 || sector_idx == (disk_sector_t) -1)
         break;
 
       // 여기를 cache에 쓰는 것으로 수정
@@ -648,27 +1180,10 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
         }
       else 
         {
-          /* We need a bounce buffer. */
-          if (bounce == NULL) 
-            {
-              bounce = malloc (DISK_SECTOR_SIZE);
-              if (bounce == NULL)
-                break;
-            }
-
-          /* If the sector contains data before or after the chunk
-             we're writing, then we need to read in the sector
-             first.  Otherwise we start with a sector of all zeros. */
-          if (sector_ofs > 0 || chunk_size < sector_left) {
-            // disk_read (filesys_disk, sector_idx, bounce);
-            // printf("___DEBUG_____ cache_read_buffer in inode_write_at in sector_ofs %d chunk_size %d \n", sector_ofs, chunk_size);
-            cache_read_to_buffer(sector_idx, bounce);
-          }
-          else
-             memset (bounce, 0, DISK_SECTOR_SIZE);
-          memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          // disk_write (filesys_disk, sector_idx, bounce); 
-          cache_write_from_buffer(sector_idx, bounce);
+          /* Patch the cached sector in place.  Writers may share
+             the inode lock, so a read-modify-write through a
+             bounce buffer could lose a neighbour's update. */
+          cache_write_at(sector_idx, buffer + bytes_written, sector_ofs, chunk_size);
         }
       // 여기까지 수정
 
@@ -680,11 +1195,75 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  free (bounce);
 
   return bytes_written;
 }
 
+/* Copies SIZE bytes starting at SRC_OFS in SRC to DST starting
+   at DST_OFS, sector chunk by sector chunk inside the buffer
+   cache.  DST is grown once up front through inode_grow(), the
+   same path inode_write_at() uses.  Returns the number of bytes
+   copied, which is short if SRC ends first and 0 if DST denies
+   writes, growing DST fails, or SRC and DST are the same inode
+   and the two ranges overlap.
+
+   Both inode locks are taken in order of inode sector so that
+   two copies running in opposite directions cannot deadlock. */
+off_t
+inode_copy_range (struct inode *dst, off_t dst_ofs,
+                  struct inode *src, off_t src_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+  bool exclusive;
+
+  if (dst->deny_write_cnt || src_ofs >= inode_length (src))
+    return 0;
+  if (size > inode_length (src) - src_ofs)
+    size = inode_length (src) - src_ofs;
+  if (size <= 0)
+    return 0;
+  if (src == dst && src_ofs < dst_ofs + size && dst_ofs < src_ofs + size)
+    return 0;
+
+  if (src != dst && src->sector < dst->sector)
+    rw_lock_acquire_read (&src->rw_lock);
+  exclusive = write_lock_acquire (dst, dst_ofs + size);
+  if (src != dst && src->sector > dst->sector)
+    rw_lock_acquire_read (&src->rw_lock);
+
+  if (inode_grow (dst, dst_ofs + size))
+    while (size > 0)
+      {
+        int src_sector_ofs = src_ofs % DISK_SECTOR_SIZE;
+        int dst_sector_ofs = dst_ofs % DISK_SECTOR_SIZE;
+
+        /* Bytes left in either sector, then in the request. */
+        int chunk_size = DISK_SECTOR_SIZE - (src_sector_ofs > dst_sector_ofs
+                                             ? src_sector_ofs : dst_sector_ofs);
+        disk_sector_t dst_sector;
+        if (chunk_size > size)
+          chunk_size = size;
+
+        dst_sector = byte_to_sector_for_write (dst, dst_ofs);
+        if (dst_sector == (disk_sector_t) -1)
+          break;
+        cache_copy (dst_sector, dst_sector_ofs,
+                    byte_to_sector (src, src_ofs), src_sector_ofs,
+                    chunk_size);
+
+        /* Advance. */
+        size -= chunk_size;
+        src_ofs += chunk_size;
+        dst_ofs += chunk_size;
+        bytes_copied += chunk_size;
+      }
+
+  if (src != dst)
+    rw_lock_release_read (&src->rw_lock);
+  write_lock_release (dst, exclusive);
+  return bytes_copied;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -713,6 +1292,22 @@ inode_length (const struct inode *inode)
 }
 
 
+/* Marks INODE as a directory whose parent directory's inode is
+   in sector PARENT, and writes that to disk. */
+void
+inode_set_dir (struct inode *inode, disk_sector_t parent)
+{
+  inode->isdir = true;
+  inode->parent = parent;
+  inode->data.isdir = 1;
+  inode->data.parent = parent;
+
+  journal_begin ();
+  if (store_index (&inode->data))
+    cache_write_from_buffer (inode->sector, &inode->data);
+  journal_end ();
+}
+
 disk_sector_t
 inode_parent (const struct inode *inode)
 {
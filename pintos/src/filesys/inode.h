@@ -3,8 +3,10 @@
 
 #include <stdbool.h>
 #include <list.h>
+#include <iovec.h>
 #include "filesys/off_t.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
 
 #define INODE_MAGIC 0x494e4f44
 
@@ -23,13 +25,23 @@ struct inode_disk
     // disk_sector_t start;                /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
+    uint32_t cow;                       /* Nonzero if data sectors may
+                                           be shared with a clone. */
+    uint32_t isdir;                     /* Nonzero for a directory. */
+    disk_sector_t parent;               /* Parent directory's inode. */
+
+    /* Where indirect_index[] and double_indirect_index are kept
+       on disk, or 0 if not written yet.  The double indirect
+       sector holds the sector numbers of its rows. */
+    disk_sector_t indirect_sector[INDIRECT_BLOCK_SIZE];
+    disk_sector_t double_indirect_sector;
     // uint32_t unused[125];               /* Not used. */
-    uint32_t unused[110];               /* Not used. */
+    uint32_t unused[96];                /* Not used. */
 
     //
     disk_sector_t direct_index[DIRECT_BLOCK_SIZE];
-    disk_sector_t *indirect_index[INDIRECT_BLOCK_SIZE];
-    disk_sector_t **double_indirect_index;
+    disk_sector_t *indirect_index[INDIRECT_BLOCK_SIZE];  /* In memory only. */
+    disk_sector_t **double_indirect_index;               /* In memory only. */
     size_t sectors; 
   };
 
@@ -42,6 +54,8 @@ struct inode
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
     struct inode_disk data;             /* Inode content. */
+    struct rw_lock rw_lock;             /* Shared for reads, exclusive
+                                           for extending writes. */
 
     //
     bool isdir;
@@ -51,6 +65,7 @@ struct inode
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t);
+bool inode_clone (disk_sector_t, struct inode *);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 struct inode *inode_get (disk_sector_t);
@@ -59,11 +74,16 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_readv_at (struct inode *, const struct iovec *, int cnt, off_t offset);
+off_t inode_writev_at (struct inode *, const struct iovec *, int cnt, off_t offset);
+off_t inode_copy_range (struct inode *dst, off_t dst_ofs,
+                        struct inode *src, off_t src_ofs, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 disk_sector_t inode_parent (const struct inode *);
 bool inode_isdir (const struct inode *);
+void inode_set_dir (struct inode *, disk_sector_t parent);
 int inode_open_cnt(const struct inode *);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,380 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* A write-ahead journal for file system metadata.
+
+   Code that changes metadata (inode_create(), inode growth,
+   dir_add(), dir_remove()) brackets the change with
+   journal_begin() and journal_end().  Every cache entry a thread
+   dirties inside such a transaction is "logged": it joins the
+   running set and is pinned in the cache, so that no partial
+   update can reach its home location early.
+
+   Transactions are committed as a group.  Once no transaction is
+   open and the running set holds JOURNAL_COMMIT_THRESHOLD
+   sectors or more, the whole set is written to the log area with
+   one multi-sector write, followed by the header, which is the
+   commit point.  After that the entries are unpinned and go home
+   through normal cache write-back.  Before the next commit
+   reuses the log area, the previous commit's snapshot is written
+   to the home locations directly (the cached copies may already
+   hold newer, uncommitted changes), so at most one committed
+   transaction is ever outstanding.
+
+   The log holds JOURNAL_MAX_BLOCKS sectors.  A thread about to
+   dirty a cached sector inside a transaction first calls
+   journal_reserve(), which serializes logging on journal_lock
+   and, if the running set is full, commits it on the spot even
+   though transactions are still open.  Such a split commits the
+   open transactions' updates so far, so they are no longer
+   atomic as a whole, but every metadata update still reaches the
+   log before its home location.
+
+   On mount, journal_init() copies a committed transaction's
+   sectors to their home locations again.  This is idempotent, so
+   a crash during the replay itself is harmless.
+
+   A sector of the last commit may change outside the journal
+   before that commit has been written home: a file write can
+   reach a sector the commit freed, or metadata can be written
+   outside a transaction.  Writing the snapshot home, on reuse of
+   the log or on replay, would then undo the newer contents, so
+   such a sector is revoked: it is marked JOURNAL_REVOKED in the
+   header and skipped.  A sector that is freed is also dropped
+   from the running set.
+
+   File data is not journaled and not ordered against the
+   metadata that points to it. */
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* Running set size at which the last journal_end() commits. */
+#define JOURNAL_COMMIT_THRESHOLD 16
+
+/* Header target of a revoked log sector. */
+#define JOURNAL_REVOKED ((disk_sector_t) -1)
+
+/* On-disk journal header.
+   Must be exactly DISK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* Commit sequence number. */
+    uint32_t cnt;                       /* Logged sectors, 0 if none. */
+    disk_sector_t targets[JOURNAL_MAX_BLOCKS]; /* Home sectors. */
+    uint8_t unused[DISK_SECTOR_SIZE - 12
+                   - JOURNAL_MAX_BLOCKS * sizeof (disk_sector_t)];
+  };
+
+/* Whether this disk has a journal.  Disks formatted before the
+   journal existed do not reserve its sectors. */
+static bool enabled;
+
+static struct lock journal_lock;     /* Serializes begin/end and commits. */
+static int active;                   /* Threads with an open transaction. */
+static uint32_t seq;                 /* Last sequence number used. */
+
+/* Sectors logged by open or finished but uncommitted
+   transactions.  Protected by cache_lock. */
+static disk_sector_t running[JOURNAL_MAX_BLOCKS];
+static size_t running_cnt;
+
+/* Snapshot of the last commit, not yet known to be home, and
+   the sectors it belongs to.  Protected by cache_lock. */
+static uint8_t *committed_buf;
+static disk_sector_t committed[JOURNAL_MAX_BLOCKS];
+static size_t committed_cnt;
+
+static struct journal_header header;
+
+static void write_header (size_t cnt);
+static void commit (void);
+static void revoke (disk_sector_t, bool write_home);
+
+/* Initializes the journal.  Unless FORMAT is true, first replays
+   a transaction that was committed but perhaps not checkpointed
+   before the last shutdown. */
+void
+journal_init (bool format)
+{
+  lock_init (&journal_lock);
+
+  if (!format)
+    {
+      filesys_read (JOURNAL_SECTOR, &header, 1);
+      if (header.magic != JOURNAL_MAGIC)
+        {
+          printf ("journal: no journal on disk, metadata updates "
+                  "will not be journaled\n");
+          return;
+        }
+      seq = header.seq;
+      if (header.cnt > 0 && header.cnt <= JOURNAL_MAX_BLOCKS)
+        {
+          uint8_t *buf = malloc (header.cnt * DISK_SECTOR_SIZE);
+          size_t i;
+
+          if (buf == NULL)
+            PANIC ("journal: cannot allocate replay buffer");
+          filesys_read (JOURNAL_SECTOR + 1, buf, header.cnt);
+          for (i = 0; i < header.cnt; i++)
+            if (header.targets[i] != JOURNAL_REVOKED)
+              filesys_write (header.targets[i],
+                             buf + i * DISK_SECTOR_SIZE, 1);
+          printf ("journal: replayed %"PRIu32" sectors of transaction "
+                  "%"PRIu32"\n", header.cnt, header.seq);
+          free (buf);
+        }
+    }
+
+  write_header (0);
+  enabled = true;
+}
+
+/* Commits whatever is pending, writes every cached sector home
+   and leaves an empty journal behind. */
+void
+journal_done (void)
+{
+  if (enabled)
+    {
+      lock_acquire (&journal_lock);
+      ASSERT (active == 0);
+      commit ();
+      lock_release (&journal_lock);
+    }
+  all_cache_entry_back_to_disk ();
+  if (enabled)
+    write_header (0);
+}
+
+/* Opens a transaction for the running thread.  Transactions
+   nest; only the outermost pair counts. */
+void
+journal_begin (void)
+{
+  struct thread *t = thread_current ();
+
+  if (t->journal_depth++ > 0 || !enabled)
+    return;
+  lock_acquire (&journal_lock);
+  active++;
+  lock_release (&journal_lock);
+}
+
+/* Closes the running thread's transaction.  The last transaction
+   to close commits the group once it is big enough. */
+void
+journal_end (void)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (t->journal_depth > 0);
+  if (--t->journal_depth > 0 || !enabled)
+    return;
+  lock_acquire (&journal_lock);
+  if (--active == 0 && running_cnt >= JOURNAL_COMMIT_THRESHOLD)
+    commit ();
+  lock_release (&journal_lock);
+}
+
+/* Commits the running set now, if no transaction is open. */
+void
+journal_commit (void)
+{
+  if (!enabled)
+    return;
+  lock_acquire (&journal_lock);
+  if (active == 0)
+    commit ();
+  lock_release (&journal_lock);
+}
+
+/* Called by the cache before it takes cache_lock to dirty a
+   sector.  If the running thread is inside a transaction, takes
+   journal_lock until journal_unreserve(), so that the sector
+   can be logged, splitting the running set off into a commit of
+   its own first if it is full. */
+void
+journal_reserve (void)
+{
+  if (!enabled || thread_current ()->journal_depth == 0)
+    return;
+  lock_acquire (&journal_lock);
+  if (running_cnt >= JOURNAL_MAX_BLOCKS)
+    commit ();
+}
+
+/* Ends what journal_reserve() started. */
+void
+journal_unreserve (void)
+{
+  if (lock_held_by_current_thread (&journal_lock))
+    lock_release (&journal_lock);
+}
+
+/* Called by the cache, with cache_lock held, whenever ENTRY is
+   dirtied, between journal_reserve() and journal_unreserve().
+   Adds ENTRY to the running set if the running thread is inside
+   a transaction, and otherwise revokes it from the last commit
+   as journal_forget() does. */
+void
+journal_log (struct cache_entry *entry)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  if (!enabled || entry->logged)
+    return;
+  if (thread_current ()->journal_depth == 0)
+    {
+      revoke (entry->sector, true);
+      return;
+    }
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  ASSERT (running_cnt < JOURNAL_MAX_BLOCKS);
+  running[running_cnt++] = entry->sector;
+  entry->logged = true;
+}
+
+/* Called by the cache, with cache_lock held, before it writes
+   file data to SECTOR, which is never journaled.  If the last
+   commit holds SECTOR, its snapshot goes home now and is revoked,
+   so that it cannot overwrite the data later. */
+void
+journal_forget (disk_sector_t sector)
+{
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  if (enabled)
+    revoke (sector, true);
+}
+
+/* Called by free_map_release() for SECTOR before it is marked
+   free.  Drops SECTOR from the running set and revokes it from
+   the last commit, so that neither puts old metadata over
+   whatever SECTOR holds next. */
+void
+journal_release (disk_sector_t sector)
+{
+  struct cache_entry *e;
+  size_t i;
+
+  if (!enabled)
+    return;
+  lock_acquire (&cache_lock);
+  e = cache_entry_find (sector);
+  if (e != NULL && e->logged)
+    {
+      for (i = 0; i < running_cnt; i++)
+        if (running[i] == sector)
+          {
+            running[i] = running[--running_cnt];
+            break;
+          }
+      e->logged = false;
+    }
+  revoke (sector, false);
+  lock_release (&cache_lock);
+}
+
+/* Revokes SECTOR from the last commit, if it is there, first
+   writing its snapshot home if WRITE_HOME.  Caller must hold
+   cache_lock. */
+static void
+revoke (disk_sector_t sector, bool write_home)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&cache_lock));
+
+  for (i = 0; i < committed_cnt; i++)
+    if (committed[i] == sector)
+      {
+        if (write_home)
+          filesys_write (sector, committed_buf + i * DISK_SECTOR_SIZE, 1);
+        committed[i] = header.targets[i] = JOURNAL_REVOKED;
+        write_header (committed_cnt);
+        return;
+      }
+}
+
+/* Writes an empty (CNT == 0) or committed header. */
+static void
+write_header (size_t cnt)
+{
+  header.magic = JOURNAL_MAGIC;
+  header.seq = seq;
+  header.cnt = cnt;
+  filesys_write (JOURNAL_SECTOR, &header, 1);
+}
+
+/* Writes the running set to the log and commits it.  Caller
+   must hold journal_lock, so the running set cannot change
+   underneath.  Transactions are normally closed, except when
+   journal_reserve() splits a full running set.  The commit runs
+   under cache_lock, so that no sector is revoked halfway. */
+static void
+commit (void)
+{
+  uint8_t *buf;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+
+  if (running_cnt == 0)
+    return;
+
+  lock_acquire (&cache_lock);
+
+  /* Make room in the log: the previous commit must be home
+     before its copy is overwritten. */
+  if (committed_cnt > 0)
+    {
+      for (i = 0; i < committed_cnt; i++)
+        if (committed[i] != JOURNAL_REVOKED)
+          filesys_write (committed[i],
+                         committed_buf + i * DISK_SECTOR_SIZE, 1);
+      write_header (0);
+      free (committed_buf);
+      committed_buf = NULL;
+      committed_cnt = 0;
+    }
+
+  buf = malloc (running_cnt * DISK_SECTOR_SIZE);
+  if (buf == NULL)
+    PANIC ("journal: cannot allocate commit buffer");
+
+  /* Snapshot the logged sectors.  They are pinned, so all of
+     them are still cached. */
+  for (i = 0; i < running_cnt; i++)
+    {
+      struct cache_entry *e = cache_entry_find (running[i]);
+      ASSERT (e != NULL && e->logged);
+      memcpy (buf + i * DISK_SECTOR_SIZE, e->data, DISK_SECTOR_SIZE);
+      header.targets[i] = running[i];
+    }
+
+  filesys_write (JOURNAL_SECTOR + 1, buf, running_cnt);
+  seq++;
+  write_header (running_cnt);
+
+  /* Committed: the sectors may go home whenever the cache
+     likes. */
+  for (i = 0; i < running_cnt; i++)
+    {
+      cache_entry_find (running[i])->logged = false;
+      committed[i] = running[i];
+    }
+  committed_buf = buf;
+  committed_cnt = running_cnt;
+  running_cnt = 0;
+  lock_release (&cache_lock);
+}
@@ -0,0 +1,28 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Sectors reserved for the journal: one header sector followed
+   by JOURNAL_MAX_BLOCKS log sectors, starting at JOURNAL_SECTOR
+   (see filesys.h). */
+#define JOURNAL_MAX_BLOCKS 32
+#define JOURNAL_SECTORS (1 + JOURNAL_MAX_BLOCKS)
+
+struct cache_entry;
+
+void journal_init (bool format);
+void journal_done (void);
+
+void journal_begin (void);
+void journal_end (void);
+void journal_commit (void);
+
+void journal_reserve (void);
+void journal_unreserve (void);
+void journal_log (struct cache_entry *);
+void journal_forget (disk_sector_t);
+void journal_release (disk_sector_t);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,33 @@
+#ifndef __LIB_DISK_STATS_H
+#define __LIB_DISK_STATS_H
+
+/* Buckets in a disk latency histogram.  Bucket 0 counts requests
+   that completed in under 1 us, bucket I counts those that took
+   from 2**(I-1) up to 2**I us, and the last bucket also counts
+   everything slower. */
+#define DISK_LATENCY_BUCKETS 20
+
+/* I/O statistics for one disk, as returned by the disk_stats()
+   system call. */
+struct disk_stats
+  {
+    long long read_cnt;         /* Sectors read. */
+    long long write_cnt;        /* Sectors written. */
+    long long read_bytes;       /* Bytes read. */
+    long long write_bytes;      /* Bytes written. */
+    long long requests;         /* Requests completed. */
+    long long commands;         /* Commands issued, after merging. */
+
+    int queue_depth;            /* Requests queued or in progress. */
+    int max_queue_depth;        /* Highest queue_depth seen. */
+    long long queue_depth_sum;  /* Sum of the queue depth each request
+                                   found on submission. */
+
+    long long lock_wait_us;     /* Time spent waiting to acquire the
+                                   disk's queue and channel locks. */
+    long long busy_us;          /* Time spent executing commands. */
+    long long latency[DISK_LATENCY_BUCKETS];    /* Request latency
+                                                   histogram. */
+  };
+
+#endif /* lib/disk-stats.h */
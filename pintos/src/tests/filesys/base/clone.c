@@ -0,0 +1,74 @@
+/* Clones a file, then writes different parts of the original and
+   the clone and checks that neither write shows through in the
+   other file, including after the original is removed. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 3000
+#define PATCH_SIZE 600
+
+static char data[FILE_SIZE];
+static char orig_data[FILE_SIZE];
+static char clone_data[FILE_SIZE];
+static char back[FILE_SIZE];
+
+static void
+verify_file (const char *file_name, const char *expected)
+{
+  int fd;
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (read (fd, back, FILE_SIZE) == FILE_SIZE, "read \"%s\"", file_name);
+  compare_bytes (back, expected, FILE_SIZE, 0, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
+
+static void
+patch_file (const char *file_name, char *expected, size_t ofs)
+{
+  int fd;
+
+  random_bytes (expected + ofs, PATCH_SIZE);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  seek (fd, ofs);
+  CHECK (write (fd, expected + ofs, PATCH_SIZE) == PATCH_SIZE,
+         "write %d bytes at offset %zu in \"%s\"", PATCH_SIZE, ofs, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (data, sizeof data);
+  CHECK (create ("orig", 0), "create \"orig\"");
+  CHECK ((fd = open ("orig")) > 1, "open \"orig\"");
+  CHECK (write (fd, data, sizeof data) == sizeof data, "write \"orig\"");
+  msg ("close \"orig\"");
+  close (fd);
+
+  CHECK (clone ("orig", "copy"), "clone \"orig\" to \"copy\"");
+  CHECK (!clone ("orig", "copy"), "clone onto existing \"copy\" fails");
+  memcpy (orig_data, data, sizeof data);
+  memcpy (clone_data, data, sizeof data);
+  verify_file ("copy", clone_data);
+
+  patch_file ("copy", clone_data, 700);
+  verify_file ("orig", orig_data);
+  verify_file ("copy", clone_data);
+
+  patch_file ("orig", orig_data, 100);
+  verify_file ("orig", orig_data);
+  verify_file ("copy", clone_data);
+
+  CHECK (remove ("orig"), "remove \"orig\"");
+  verify_file ("copy", clone_data);
+}
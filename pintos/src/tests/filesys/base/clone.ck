@@ -0,0 +1,40 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(clone) begin
+(clone) create "orig"
+(clone) open "orig"
+(clone) write "orig"
+(clone) close "orig"
+(clone) clone "orig" to "copy"
+(clone) clone onto existing "copy" fails
+(clone) open "copy"
+(clone) read "copy"
+(clone) close "copy"
+(clone) open "copy"
+(clone) write 600 bytes at offset 700 in "copy"
+(clone) close "copy"
+(clone) open "orig"
+(clone) read "orig"
+(clone) close "orig"
+(clone) open "copy"
+(clone) read "copy"
+(clone) close "copy"
+(clone) open "orig"
+(clone) write 600 bytes at offset 100 in "orig"
+(clone) close "orig"
+(clone) open "orig"
+(clone) read "orig"
+(clone) close "orig"
+(clone) open "copy"
+(clone) read "copy"
+(clone) close "copy"
+(clone) remove "orig"
+(clone) open "copy"
+(clone) read "copy"
+(clone) close "copy"
+(clone) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Copies most of one file into another at a different sector
+   alignment with copy_file_range(), then checks the copied bytes,
+   the returned length and both file positions. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SRC_SIZE 5000
+#define SRC_OFS 100
+#define DST_OFS 3
+
+static char data[SRC_SIZE];
+static char back[DST_OFS + SRC_SIZE - SRC_OFS];
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd;
+
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((in_fd = open ("src")) > 1, "open \"src\"");
+  random_bytes (data, sizeof data);
+  CHECK (write (in_fd, data, sizeof data) == sizeof data, "write \"src\"");
+
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((out_fd = open ("dst")) > 1, "open \"dst\"");
+  CHECK (write (out_fd, "abc", DST_OFS) == DST_OFS, "write \"dst\" header");
+
+  msg ("seek \"src\" to %d", SRC_OFS);
+  seek (in_fd, SRC_OFS);
+  CHECK (copy_file_range (in_fd, out_fd, 2 * SRC_SIZE) == SRC_SIZE - SRC_OFS,
+         "copy_file_range stops at end of \"src\"");
+  CHECK (tell (in_fd) == SRC_SIZE, "\"src\" position advanced");
+  CHECK (tell (out_fd) == sizeof back, "\"dst\" position advanced");
+  CHECK (copy_file_range (in_fd, out_fd, 1) == 0,
+         "copy_file_range at end of file returns 0");
+
+  msg ("seek \"dst\" to 0");
+  seek (out_fd, 0);
+  CHECK (read (out_fd, back, sizeof back) == sizeof back, "read \"dst\"");
+  if (memcmp (back, "abc", DST_OFS))
+    fail ("header of \"dst\" was overwritten");
+  compare_bytes (back + DST_OFS, data + SRC_OFS, SRC_SIZE - SRC_OFS, 0, "dst");
+
+  msg ("close \"src\"");
+  close (in_fd);
+  msg ("close \"dst\"");
+  close (out_fd);
+}
@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) create "src"
+(copy-file-range) open "src"
+(copy-file-range) write "src"
+(copy-file-range) create "dst"
+(copy-file-range) open "dst"
+(copy-file-range) write "dst" header
+(copy-file-range) seek "src" to 100
+(copy-file-range) copy_file_range stops at end of "src"
+(copy-file-range) "src" position advanced
+(copy-file-range) "dst" position advanced
+(copy-file-range) copy_file_range at end of file returns 0
+(copy-file-range) seek "dst" to 0
+(copy-file-range) read "dst"
+(copy-file-range) close "src"
+(copy-file-range) close "dst"
+(copy-file-range) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Checks that the file system disk's statistics account for a
+   file written in between two disk_stats() calls, and that a
+   missing disk is reported as such.  Closing a file does not
+   flush it, so the file is twice the size of the 64-sector
+   buffer cache: at least half of its sectors must have been
+   written to disk to make room for the rest. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[128 * 512];
+static struct disk_stats before, after;
+
+void
+test_main (void) 
+{
+  long long hist_sum;
+  int fd, i;
+
+  CHECK (disk_stats (0, 1, &before), "get hd0:1 statistics");
+  CHECK (!disk_stats (2, 0, &after), "no statistics for hd2:0");
+
+  CHECK (create ("data", sizeof buf), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  memset (buf, 0x5a, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"data\"");
+  msg ("close \"data\"");
+  close (fd);
+
+  CHECK (disk_stats (0, 1, &after), "get hd0:1 statistics again");
+  CHECK (after.write_cnt >= before.write_cnt + sizeof buf / 512 / 2,
+         "sector writes include \"data\"");
+  CHECK (after.write_bytes == after.write_cnt * 512,
+         "bytes written match sectors written");
+  CHECK (after.commands <= after.requests, "no more commands than requests");
+
+  hist_sum = 0;
+  for (i = 0; i < DISK_LATENCY_BUCKETS; i++)
+    hist_sum += after.latency[i];
+  CHECK (hist_sum == after.requests, "latency histogram covers all requests");
+}
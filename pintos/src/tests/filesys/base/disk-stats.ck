@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(disk-stats) begin
+(disk-stats) get hd0:1 statistics
+(disk-stats) no statistics for hd2:0
+(disk-stats) create "data"
+(disk-stats) open "data"
+(disk-stats) write "data"
+(disk-stats) close "data"
+(disk-stats) get hd0:1 statistics again
+(disk-stats) sector writes include "data"
+(disk-stats) bytes written match sectors written
+(disk-stats) no more commands than requests
+(disk-stats) latency histogram covers all requests
+(disk-stats) end
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Passes pread() a buffer that starts in the top user page and is
+   long enough that its end wraps around past PHYS_BASE.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *file_name = "positional";
+  int fd;
+
+  CHECK (create (file_name, 512), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  pread (fd, (char *) 0xbffff000, 0x7fffffff, 0);
+  fail ("should not have survived pread()");
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-bad-ptr) begin
+(pread-bad-ptr) create "positional"
+(pread-bad-ptr) open "positional"
+pread-bad-ptr: exit(-1)
+EOF
+pass;
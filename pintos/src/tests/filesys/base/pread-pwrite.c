@@ -0,0 +1,62 @@
+/* Writes a file in scattered blocks with pwrite(), reads it back
+   with pread(), and verifies that neither call moves the file
+   position. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 700
+#define BLOCK_CNT 8
+
+static char buf1[BLOCK_SIZE * BLOCK_CNT];
+static char buf2[BLOCK_SIZE * BLOCK_CNT];
+
+void
+test_main (void) 
+{
+  const char *file_name = "positional";
+  size_t order[BLOCK_CNT];
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  random_bytes (buf1, sizeof buf1);
+  for (i = 0; i < BLOCK_CNT; i++)
+    order[i] = i;
+  shuffle (order, BLOCK_CNT, sizeof *order);
+
+  msg ("pwrite \"%s\" in random order", file_name);
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      size_t ofs = order[i] * BLOCK_SIZE;
+      if (pwrite (fd, buf1 + ofs, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("pwrite %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  CHECK (tell (fd) == 0, "file position unchanged by pwrite");
+  CHECK (filesize (fd) == sizeof buf1, "filesize is %zu", sizeof buf1);
+
+  msg ("pread \"%s\" in reverse order", file_name);
+  for (i = BLOCK_CNT; i-- > 0; )
+    {
+      size_t ofs = i * BLOCK_SIZE;
+      if (pread (fd, buf2 + ofs, BLOCK_SIZE, ofs) != BLOCK_SIZE)
+        fail ("pread %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+    }
+  CHECK (tell (fd) == 0, "file position unchanged by pread");
+  compare_bytes (buf2, buf1, sizeof buf1, 0, file_name);
+
+  CHECK (pread (fd, buf2, BLOCK_SIZE, sizeof buf1) == 0,
+         "pread at end of file returns 0");
+  CHECK (pread (fd, buf2, 512, 0xfffffe00) == -1,
+         "pread at offset past off_t range returns -1");
+  CHECK (pwrite (fd, buf1, 512, 0x7fffff00) == -1,
+         "pwrite ending past off_t range returns -1");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
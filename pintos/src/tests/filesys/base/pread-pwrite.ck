@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "positional"
+(pread-pwrite) open "positional"
+(pread-pwrite) pwrite "positional" in random order
+(pread-pwrite) file position unchanged by pwrite
+(pread-pwrite) filesize is 5600
+(pread-pwrite) pread "positional" in reverse order
+(pread-pwrite) file position unchanged by pread
+(pread-pwrite) pread at end of file returns 0
+(pread-pwrite) pread at offset past off_t range returns -1
+(pread-pwrite) pwrite ending past off_t range returns -1
+(pread-pwrite) close "positional"
+(pread-pwrite) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Writes a series of header+payload records with writev(), then
+   reads them back with readv() into differently split buffers
+   and checks the contents. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RECORD_CNT 10
+#define HEADER_SIZE 12
+#define PAYLOAD_SIZE 500
+
+static char data[RECORD_CNT * (HEADER_SIZE + PAYLOAD_SIZE)];
+static char back[sizeof data];
+
+void
+test_main (void) 
+{
+  const char *file_name = "records";
+  struct iovec iov[3];
+  size_t i, ofs;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+
+  random_bytes (data, sizeof data);
+  msg ("writev %d records", RECORD_CNT);
+  for (i = 0, ofs = 0; i < RECORD_CNT; i++)
+    {
+      iov[0].iov_base = data + ofs;
+      iov[0].iov_len = HEADER_SIZE;
+      iov[1].iov_base = data + ofs + HEADER_SIZE;
+      iov[1].iov_len = PAYLOAD_SIZE;
+      if (writev (fd, iov, 2) != HEADER_SIZE + PAYLOAD_SIZE)
+        fail ("writev of record %zu failed", i);
+      ofs += HEADER_SIZE + PAYLOAD_SIZE;
+    }
+  CHECK (tell (fd) == sizeof data, "file position advanced to %zu",
+         sizeof data);
+
+  msg ("seek \"%s\" to 0", file_name);
+  seek (fd, 0);
+  iov[0].iov_base = back;
+  iov[0].iov_len = 1;
+  iov[1].iov_base = back + 1;
+  iov[1].iov_len = sizeof back / 2;
+  iov[2].iov_base = back + 1 + sizeof back / 2;
+  iov[2].iov_len = sizeof back - 1 - sizeof back / 2;
+  CHECK (readv (fd, iov, 3) == sizeof back, "readv whole file");
+  compare_bytes (back, data, sizeof data, 0, file_name);
+
+  CHECK (writev (fd, iov, 0) == -1, "writev of zero buffers fails");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "records"
+(readv-writev) open "records"
+(readv-writev) writev 10 records
+(readv-writev) file position advanced to 5120
+(readv-writev) seek "records" to 0
+(readv-writev) readv whole file
+(readv-writev) writev of zero buffers fails
+(readv-writev) close "records"
+(readv-writev) end
+EOF
+pass;
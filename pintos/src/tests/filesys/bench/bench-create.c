@@ -0,0 +1,51 @@
+/* Measures small file creation and deletion rates: creates
+   batches of one-sector files in the root directory, then
+   deletes them again. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char data[512];
+static const int counts[] = {16, 64, 256};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  memset (data, 0x3c, sizeof data);
+  for (i = 0; i < sizeof counts / sizeof *counts; i++)
+    {
+      int cnt = counts[i];
+      char name[16];
+      struct bench b;
+      int j;
+
+      bench_start (&b);
+      for (j = 0; j < cnt; j++)
+        {
+          int fd;
+
+          snprintf (name, sizeof name, "f%d", j);
+          if (!create (name, 0) || (fd = open (name)) < 2)
+            fail ("create \"%s\" failed", name);
+          if (write (fd, data, sizeof data) != sizeof data)
+            fail ("write \"%s\" failed", name);
+          close (fd);
+        }
+      bench_end (&b, "create %d files", cnt);
+
+      bench_start (&b);
+      for (j = 0; j < cnt; j++)
+        {
+          snprintf (name, sizeof name, "f%d", j);
+          if (!remove (name))
+            fail ("remove \"%s\" failed", name);
+        }
+      bench_end (&b, "delete %d files", cnt);
+    }
+}
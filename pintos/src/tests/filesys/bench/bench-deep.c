@@ -0,0 +1,58 @@
+/* Measures path lookup latency: opens and closes a file at the
+   bottom of directory chains of several depths. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define OPEN_CNT 100
+
+static const int depths[] = {1, 4, 16};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  for (i = 0; i < sizeof depths / sizeof *depths; i++)
+    {
+      int depth = depths[i];
+      char path[128];
+      struct bench b;
+      int d, j;
+
+      /* Build "/d0/d1/.../file". */
+      path[0] = '\0';
+      for (d = 0; d < depth; d++)
+        {
+          snprintf (path + strlen (path), sizeof path - strlen (path),
+                    "/d%d", d);
+          if (!mkdir (path))
+            fail ("mkdir \"%s\" failed", path);
+        }
+      strlcat (path, "/file", sizeof path);
+      CHECK (create (path, 512), "create file at depth %d", depth);
+
+      bench_start (&b);
+      for (j = 0; j < OPEN_CNT; j++)
+        {
+          int fd = open (path);
+          if (fd < 2)
+            fail ("open \"%s\" failed", path);
+          close (fd);
+        }
+      bench_end (&b, "open %d times at depth %d", OPEN_CNT, depth);
+
+      /* Tear the chain down again, bottom up. */
+      CHECK (remove (path), "remove file at depth %d", depth);
+      for (d = depth; d > 0; d--)
+        {
+          *strrchr (path, '/') = '\0';
+          if (!remove (path))
+            fail ("remove \"%s\" failed", path);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/* Measures random access throughput: writes and then reads
+   single sectors at random offsets within files of several
+   sizes. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+#define OP_CNT 256
+
+static char block[BLOCK_SIZE];
+static const size_t sizes[] = {64 * 1024, 512 * 1024, 2048 * 1024};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  random_init (0);
+  memset (block, 0xa5, sizeof block);
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      size_t block_cnt = size / BLOCK_SIZE;
+      struct bench b;
+      int fd, op;
+
+      CHECK (create ("random", size), "create \"random\"");
+      CHECK ((fd = open ("random")) > 1, "open \"random\"");
+
+      bench_start (&b);
+      for (op = 0; op < OP_CNT; op++)
+        {
+          seek (fd, random_ulong () % block_cnt * BLOCK_SIZE);
+          if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+            fail ("write %d failed", op);
+        }
+      bench_end (&b, "write %d x %d B in %zu kB", OP_CNT, BLOCK_SIZE,
+                 size / 1024);
+
+      bench_start (&b);
+      for (op = 0; op < OP_CNT; op++)
+        {
+          seek (fd, random_ulong () % block_cnt * BLOCK_SIZE);
+          if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+            fail ("read %d failed", op);
+        }
+      bench_end (&b, "read %d x %d B in %zu kB", OP_CNT, BLOCK_SIZE,
+                 size / 1024);
+
+      msg ("close \"random\"");
+      close (fd);
+      CHECK (remove ("random"), "remove \"random\"");
+    }
+}
@@ -0,0 +1,60 @@
+/* Measures directory listing speed: reads through directories
+   holding several numbers of entries. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PASS_CNT 10
+
+static const int counts[] = {16, 64, 256};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  for (i = 0; i < sizeof counts / sizeof *counts; i++)
+    {
+      int cnt = counts[i];
+      char dir[16], name[32];
+      struct bench b;
+      int j, pass;
+
+      snprintf (dir, sizeof dir, "/dir%d", cnt);
+      CHECK (mkdir (dir), "mkdir \"%s\"", dir);
+      for (j = 0; j < cnt; j++)
+        {
+          snprintf (name, sizeof name, "%s/f%d", dir, j);
+          if (!create (name, 0))
+            fail ("create \"%s\" failed", name);
+        }
+
+      bench_start (&b);
+      for (pass = 0; pass < PASS_CNT; pass++)
+        {
+          char entry[READDIR_MAX_LEN + 1];
+          int fd = open (dir);
+          int found = 0;
+
+          if (fd < 2)
+            fail ("open \"%s\" failed", dir);
+          while (readdir (fd, entry))
+            found++;
+          close (fd);
+          if (found != cnt)
+            fail ("\"%s\" listed %d entries, expected %d", dir, found, cnt);
+        }
+      bench_end (&b, "list %d entries %d times", cnt, PASS_CNT);
+
+      for (j = 0; j < cnt; j++)
+        {
+          snprintf (name, sizeof name, "%s/f%d", dir, j);
+          if (!remove (name))
+            fail ("remove \"%s\" failed", name);
+        }
+      CHECK (remove (dir), "remove \"%s\"", dir);
+    }
+}
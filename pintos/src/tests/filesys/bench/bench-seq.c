@@ -0,0 +1,49 @@
+/* Measures sequential throughput: writes files of several sizes
+   from start to end, one block at a time, and reads them back
+   the same way. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/filesys/bench/bench.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 4096
+
+static char block[BLOCK_SIZE];
+static const size_t sizes[] = {64 * 1024, 512 * 1024, 2048 * 1024};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  memset (block, 0x5a, sizeof block);
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    {
+      size_t size = sizes[i];
+      struct bench b;
+      size_t ofs;
+      int fd;
+
+      CHECK (create ("seq", 0), "create \"seq\"");
+      CHECK ((fd = open ("seq")) > 1, "open \"seq\"");
+
+      bench_start (&b);
+      for (ofs = 0; ofs < size; ofs += BLOCK_SIZE)
+        if (write (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("write at offset %zu failed", ofs);
+      bench_end (&b, "write %zu kB", size / 1024);
+
+      seek (fd, 0);
+      bench_start (&b);
+      for (ofs = 0; ofs < size; ofs += BLOCK_SIZE)
+        if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+          fail ("read at offset %zu failed", ofs);
+      bench_end (&b, "read %zu kB", size / 1024);
+
+      msg ("close \"seq\"");
+      close (fd);
+      CHECK (remove ("seq"), "remove \"seq\"");
+    }
+}
@@ -0,0 +1,37 @@
+#include "tests/filesys/bench/bench.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include "tests/lib.h"
+
+/* Starts timing B. */
+void
+bench_start (struct bench *b) 
+{
+  if (!disk_stats (0, 1, &b->disk))
+    fail ("no statistics for the file system disk");
+  b->ticks = uptime ();
+}
+
+/* Stops timing B and reports the ticks it took and the sectors
+   read from and written to the file system disk in the
+   meantime, labeled with FORMAT. */
+void
+bench_end (const struct bench *b, const char *format, ...) 
+{
+  struct disk_stats now;
+  char label[64];
+  va_list args;
+  long ticks;
+
+  ticks = uptime () - b->ticks;
+  if (!disk_stats (0, 1, &now))
+    fail ("no statistics for the file system disk");
+
+  va_start (args, format);
+  vsnprintf (label, sizeof label, format, args);
+  va_end (args);
+
+  msg ("%s: %ld ticks, %lld sectors read, %lld sectors written",
+       label, ticks, now.read_cnt - b->disk.read_cnt,
+       now.write_cnt - b->disk.write_cnt);
+}
@@ -0,0 +1,18 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_H
+#define TESTS_FILESYS_BENCH_BENCH_H
+
+#include <debug.h>
+#include <syscall.h>
+
+/* One timed interval of a benchmark. */
+struct bench
+  {
+    long ticks;                 /* uptime() when started. */
+    struct disk_stats disk;     /* File system disk when started. */
+  };
+
+void bench_start (struct bench *);
+void bench_end (const struct bench *, const char *format, ...)
+  PRINTF_FORMAT (2, 3);
+
+#endif /* tests/filesys/bench/bench.h */
@@ -0,0 +1,17 @@
+/* Passes read() a buffer that starts in the top user page and is
+   long enough that its end wraps around past PHYS_BASE.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  read (handle, (char *) 0xbffff000, 0x7fffffff);
+  fail ("should not have survived read()");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(read-wrap) begin
+(read-wrap) open "sample.txt"
+read-wrap: exit(-1)
+EOF
+pass;
@@ -0,0 +1,23 @@
+/* Child process of zero-exit.
+   Reads a large zero-filled array that it never writes, and
+   ensures that it reads back zeros. */
+
+#include "tests/lib.h"
+#include "tests/main.h"
+
+const char *test_name = "child-zero";
+
+#define SIZE (64 * 1024)
+static char buf[SIZE];
+
+int
+main (void)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (buf[i] != '\0')
+      fail ("byte %zu != 0", i);
+
+  return 0x42;
+}
@@ -0,0 +1,66 @@
+/* Forks a child that shares a large array with its parent
+   copy-on-write, then has both write to it, and checks that
+   neither process sees the other's writes.  Then forks a child
+   that only reads the array before it exits, and checks that the
+   parent's copy survives the child's exit. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char buf[SIZE];
+static char other[SIZE];
+
+/* Returns true if every byte of BUF[OFS...OFS+SIZE) is C. */
+static bool
+all_are (size_t ofs, size_t size, char c)
+{
+  size_t i;
+
+  for (i = ofs; i < ofs + size; i++)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  memset (buf, 'p', SIZE);
+  child = fork ();
+  if (child == 0)
+    {
+      /* The child sees the array as it was at the fork, whatever
+         the parent has written since, and has its own copy. */
+      if (!all_are (0, SIZE, 'p'))
+        exit (1);
+      memset (buf, 'c', SIZE);
+      exit (all_are (0, SIZE, 'c') ? 0 : 2);
+    }
+  CHECK (child != -1, "fork");
+
+  memset (buf, 'q', SIZE / 2);
+  CHECK (wait (child) == 0, "wait for child");
+  if (!all_are (0, SIZE / 2, 'q') || !all_are (SIZE / 2, SIZE / 2, 'p'))
+    fail ("parent's memory changed by child");
+  msg ("parent's memory unchanged by child");
+
+  /* This child exits still sharing every page of the array with
+     the parent.  Writing OTHER makes the parent take fresh frames,
+     which would reuse any page the child's exit wrongly freed. */
+  child = fork ();
+  if (child == 0)
+    exit (all_are (0, SIZE / 2, 'q') && all_are (SIZE / 2, SIZE / 2, 'p')
+          ? 0 : 1);
+  CHECK (child != -1, "fork");
+  CHECK (wait (child) == 0, "wait for child");
+  memset (other, 'o', SIZE);
+  if (!all_are (0, SIZE / 2, 'q') || !all_are (SIZE / 2, SIZE / 2, 'p'))
+    fail ("parent's memory changed by child's exit");
+  msg ("parent's memory unchanged by child's exit");
+}
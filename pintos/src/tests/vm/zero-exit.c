@@ -0,0 +1,48 @@
+/* Runs two children in turn that each read untouched zero-fill
+   memory and exit, then reads the parent's own untouched
+   zero-fill memory, before and after writing to other memory.
+   Checks that a process's exit does not give away the page its
+   untouched memory reads as zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SIZE (64 * 1024)
+
+static char zeros[SIZE];
+static char data[SIZE];
+
+/* Returns true if every byte of ZEROS is 0. */
+static bool
+all_zero (void)
+{
+  size_t i;
+
+  for (i = 0; i < SIZE; i++)
+    if (zeros[i] != '\0')
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      pid_t child;
+
+      CHECK ((child = exec ("child-zero")) != -1, "exec \"child-zero\"");
+      CHECK (wait (child) == 0x42, "wait for child");
+    }
+
+  if (!all_zero ())
+    fail ("untouched memory not zero after children exited");
+  memset (data, 0x5a, SIZE);
+  if (!all_zero ())
+    fail ("untouched memory not zero after writing other memory");
+  msg ("untouched memory reads as zeros");
+}
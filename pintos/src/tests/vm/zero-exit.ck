@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-exit) begin
+(zero-exit) exec "child-zero"
+(zero-exit) wait for child
+(zero-exit) exec "child-zero"
+(zero-exit) wait for child
+(zero-exit) untouched memory reads as zeros
+(zero-exit) end
+EOF
+pass;
@@ -29,6 +29,8 @@
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
+#include "vm/zswap.h"
 #else
 #include "tests/threads/tests.h"
 #endif
@@ -123,6 +125,7 @@ main (void)
 #endif
   swap_init ();
   frame_init ();
+  share_init ();
 
   printf ("Boot complete.\n");
   
@@ -248,6 +251,8 @@ parse_options (char **argv)
 #ifdef FILESYS
       else if (!strcmp (name, "-f"))
         format_filesys = true;
+      else if (!strcmp (name, "-stripe"))
+        filesys_striped = true;
 #endif
       else if (!strcmp (name, "-rs"))
         random_init (atoi (value));
@@ -256,6 +261,10 @@ parse_options (char **argv)
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
+      else if (!strcmp (name, "-fa"))
+        fault_around_pages = atoi (value);
+      else if (!strcmp (name, "-zs"))
+        zswap_pages = atoi (value);
 #endif
       else
         PANIC ("unknown option `%s' (use -h for help)", name);
@@ -356,10 +365,13 @@ usage (void)
           "  -h                 Print this help message and power off.\n"
           "  -q                 Power off VM after actions or on panic.\n"
           "  -f                 Format file system disk during startup.\n"
+          "  -stripe            Stripe the file system across hd0:1 and hd1:0.\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
+          "  -fa=COUNT          Map up to COUNT file pages per page fault.\n"
+          "  -zs=COUNT          Keep up to COUNT pages of compressed swap in RAM.\n"
 #endif
           );
   power_off ();
@@ -139,12 +139,15 @@ struct thread
     // project3
     struct hash spt; // supplement page table
     void *user_esp; // user stack pointer
+    struct list frame_list; // 이 프로세스가 가진 frame들 (frame_table_lock)
+    struct list pinned_list;    /* Pages pinned by frame_pin(). */
 
     struct list mfile_list;
     mapid_t mapid;
 
     // project4
     struct dir *cur_dir;
+    int journal_depth;          /* Nesting of open journal transactions. */
   };
 
 /* If false (default), use round-robin scheduler.
@@ -10,10 +10,18 @@
 #include "userprog/syscall.h"
 #include "vm/page.h"
 #include "vm/swap.h"
+#include "vm/frame.h"
+#include "vm/share.h"
+#include "userprog/pagedir.h"
+#include <string.h>
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Pages fault_around() maps in on a fault on a file-backed
+   page, counting the faulting page.  Set with -fa. */
+size_t fault_around_pages = 8;
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -41,16 +49,14 @@ void stack_grow (void *upage, void *kpage) {
   bool writable = true;
 
   if (kpage != NULL) {
-    if(!install_page(upage, kpage, writable)) free_kpage_and_exit(kpage);
-
-    // spte에 추가
-    struct sup_page_table_entry *new_spte = allocate_page(upage, kpage, 1, 1, NULL, 0, 0, 0, 1, 0); // is_in_frame
+    // spte에 추가 (zero page를 map했다가 evict된 page는 이미 있음)
+    struct sup_page_table_entry *new_spte = spte_find(upage);
+    if (new_spte == NULL)
+      new_spte = allocate_page(upage, NULL, 0, 1, NULL, 0, 0, 0, 1, 0);
     if (new_spte == NULL) free_kpage_and_exit(kpage);
-    
-    // frame table에 추가
-    struct frame_table_entry *new_fte = allocate_frame(kpage, new_spte);
-    if (new_fte == NULL) free_kpage_and_exit(kpage);
-    else new_spte->is_in_frame = 1;
+
+    // map한 뒤에 frame table에 추가
+    if (!frame_install(new_spte, kpage, writable)) free_kpage_and_exit(kpage);
   }
   else{ // frame eviction
     swap_out();
@@ -61,10 +67,11 @@ void stack_grow (void *upage, void *kpage) {
       kpage = palloc_get_page(PAL_USER);
     }
 
-    struct sup_page_table_entry *new_spte = allocate_page(upage, kpage, 0, 1, NULL, 0, 0, 0, 1, 0); // frame 꽉 참
-    allocate_frame(kpage, new_spte);
-    install_page(upage, kpage, writable);
-    new_spte->is_in_frame = 1;
+    struct sup_page_table_entry *new_spte = spte_find(upage);
+    if (new_spte == NULL)
+      new_spte = allocate_page(upage, NULL, 0, 1, NULL, 0, 0, 0, 1, 0); // frame 꽉 참
+    if (new_spte == NULL) free_kpage_and_exit(kpage);
+    if (!frame_install(new_spte, kpage, writable)) free_kpage_and_exit(kpage);
   }
 }
 
@@ -74,20 +81,60 @@ void free_kpage_and_exit(void *kpage) {
 }
 
 void load_file_lazily(void *kpage, struct sup_page_table_entry *spte) {
-  lock_acquire(&file_lock);
-  if (file_read_at (spte->file, kpage, spte->page_read_bytes, spte->ofs) != (int) spte->page_read_bytes)
+  // stack page처럼 file이 없는 zero-fill page도 온다
+  if (spte->page_read_bytes != 0
+      && file_read_at (spte->file, kpage, spte->page_read_bytes, spte->ofs) != (int) spte->page_read_bytes)
   {
     palloc_free_page (kpage);
-    lock_release(&file_lock);
     exit(-1);
   }
 
   memset (kpage + spte->page_read_bytes, 0, spte->page_zero_bytes);
-
-  lock_release(&file_lock);
   return;
 }
 
+/* Maps in the pages that follow SPTE, which was just loaded
+   from its file, while they are the next pages of the same file
+   and have never been loaded, up to fault_around_pages in all.
+   Only free frames are used, so this never evicts, and a page it
+   cannot read is left to fault in normally.  The pages are left
+   unaccessed, so the clock takes them back first if they go
+   unused. */
+void fault_around(struct sup_page_table_entry *spte) {
+  uint32_t *pd = thread_current()->pagedir;
+  size_t i;
+
+  for (i = 1; i < fault_around_pages; i++) {
+    uint8_t *upage = (uint8_t *) spte->user_vaddr + i * PGSIZE;
+    struct sup_page_table_entry *next = spte_find(upage);
+    if (next == NULL || next->file != spte->file || next->is_mapped
+        || next->page_read_bytes == 0 || next->ofs != spte->ofs + (off_t) (i * PGSIZE)
+        || pagedir_get_page(pd, upage) != NULL)
+      break;
+
+    if (share_is_shareable(next)) {
+      if (!share_page_in(next, false))
+        break;
+      continue;
+    }
+
+    void *kpage = palloc_get_page(PAL_USER);
+    if (kpage == NULL)
+      break;
+    if (file_read_at(next->file, kpage, next->page_read_bytes, next->ofs) != (int) next->page_read_bytes) {
+      palloc_free_page(kpage);
+      break;
+    }
+    memset(kpage + next->page_read_bytes, 0, next->page_zero_bytes);
+
+    /* Map it before the frame table can see it. */
+    if (!frame_install(next, kpage, next->writable)) {
+      palloc_free_page(kpage);
+      break;
+    }
+  }
+}
+
 /* Registers handlers for interrupts that can be caused by user
    programs.
 
@@ -231,7 +278,11 @@ page_fault (struct intr_frame *f)
   }
 
   // pt-write-code 막기 위해 write on read-only page 면 exit
+  // 단, fork 후 copy-on-write page에 대한 write면 private copy를 준다
   if (!not_present) {
+    struct sup_page_table_entry *cow_spte = spte_find(fault_addr);
+    if (write && cow_spte != NULL && cow_spte->writable && frame_cow_break(cow_spte))
+      return;
     exit(-1);
   }
 
@@ -240,8 +291,17 @@ page_fault (struct intr_frame *f)
 
   // Stack grow인 경우
   if (need_stack_grow(user, fault_addr, f->esp)) {
-    void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
-    stack_grow(upage, kpage);
+    struct sup_page_table_entry *stack_spte = spte_find(upage);
+    /* A read only needs the zero page */
+    if (!write && (stack_spte == NULL || share_is_zero_fill(stack_spte))) {
+      if (stack_spte == NULL)
+        stack_spte = allocate_page(upage, NULL, 0, 1, NULL, 0, 0, 0, 1, 0);
+      if (stack_spte == NULL || !share_zero_in(stack_spte)) exit(-1);
+    }
+    else {
+      void *kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+      stack_grow(upage, kpage);
+    }
   } 
   // Map page with frame
   else { 
@@ -252,6 +312,19 @@ page_fault (struct intr_frame *f)
     struct sup_page_table_entry *find_spte = spte_find(upage);
     if (find_spte == NULL) exit(-1);
 
+    /* Read-only text pages are shared between processes */
+    if (share_is_shareable(find_spte)) {
+      if (!share_page_in(find_spte, true)) exit(-1);
+      fault_around(find_spte);
+      return;
+    }
+
+    /* Reading an untouched zero-fill page maps the zero page */
+    if (!write && share_is_zero_fill(find_spte)) {
+      if (!share_zero_in(find_spte)) exit(-1);
+      return;
+    }
+
     /* Get kpage to allocate frame */
     void *kpage;
     if (find_spte->page_read_bytes != 0)
@@ -260,19 +333,19 @@ page_fault (struct intr_frame *f)
       kpage = palloc_get_page (PAL_USER | PAL_ZERO);
 
     /* Have kpage to allocate frame */
-    if (kpage != NULL) {
+    if (kpage != NULL && find_spte->is_mapped) {
+      /* Evicted before: bring it back from swap or its file */
+      if (!swap_in(upage, kpage)) free_kpage_and_exit(kpage);
+    }
+    else if (kpage != NULL) {
       /* Lazy loading */
       load_file_lazily(kpage, find_spte);
 
       /* Add kpage to frame */
-      struct frame_table_entry *new_fte = allocate_frame(kpage, find_spte);
-      if (new_fte == NULL) free_kpage_and_exit(kpage);
-      if (install_page(upage, kpage, find_spte->writable)) {
-        find_spte->frame = kpage;
-        find_spte->is_in_frame = 1;
-      } else {
+      if (!frame_install(find_spte, kpage, find_spte->writable))
         free_kpage_and_exit(kpage);
-      }
+      if (find_spte->page_read_bytes != 0)
+        fault_around(find_spte);
     }
     else { /* Frame eviction is needed */
       if (!find_spte->is_mapped) {
@@ -290,21 +363,10 @@ page_fault (struct intr_frame *f)
             kpage = palloc_get_page(PAL_USER | PAL_ZERO);
         }
 
-        if (file_read_at (find_spte->file, kpage, find_spte->page_read_bytes, find_spte->ofs) != (int) find_spte->page_read_bytes)
-        {
-          palloc_free_page (kpage);
-          exit(-1); //여기서 나감
-        }
-        memset (kpage + find_spte->page_read_bytes, 0, find_spte->page_zero_bytes);
+        load_file_lazily(kpage, find_spte);
         
-        struct frame_table_entry *new_fte = allocate_frame(kpage, find_spte);
-        if (new_fte == NULL) free_kpage_and_exit(kpage);
-        if (install_page(upage, kpage, find_spte->writable)) {
-          find_spte->frame = kpage;
-          find_spte->is_in_frame = 1;
-        } else {
+        if (!frame_install(find_spte, kpage, find_spte->writable))
           free_kpage_and_exit(kpage);
-        }
       }
       else{ /* page data is in swap or file */
         kpage = evict_frame(upage);
@@ -18,5 +18,8 @@ bool need_stack_grow (bool user, void *fault_addr, uint32_t esp);
 void stack_grow (void *upage, void *kpage);
 void free_kpage_and_exit (void *kpage);
 void load_file_lazily (void *kpage, struct sup_page_table_entry *spte);
+void fault_around (struct sup_page_table_entry *spte);
+
+extern size_t fault_around_pages;
 
 #endif /* userprog/exception.h */
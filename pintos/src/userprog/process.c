@@ -22,10 +22,12 @@
 #include "vm/swap.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func fork_process NO_RETURN;
+static bool fork_stack (struct thread *parent);
+static bool fork_files (struct thread *parent);
+bool install_page (void *upage, void *kpage, bool writable);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
-extern struct lock file_lock;
-
 /* Starts a new thread running a user program loadedm from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -141,6 +143,143 @@ start_process (void *f_name)
   NOT_REACHED ();
 }
 
+/* What fork() hands to the child it creates. */
+struct fork_info
+  {
+    struct thread *parent;
+    struct intr_frame if_;      /* Parent's user context. */
+  };
+
+/* Creates a child process that is a copy of the current one,
+   resuming from the current system call with 0 returned in eax.
+   Its memory is shared copy-on-write (see page_fork()) and its
+   file descriptors are reopened at the same positions.  Returns
+   the child's thread id, or TID_ERROR if it cannot be created. */
+tid_t
+process_fork (void)
+{
+  struct thread *curr = thread_current ();
+  struct fork_info info;
+  struct list_elem *e;
+  struct thread *child = NULL;
+  tid_t tid;
+
+  /* The user context intr_entry saved on entry to the kernel is at
+     the top of our kernel stack, where the TSS points. */
+  info.parent = curr;
+  info.if_ = *((struct intr_frame *) ((uint8_t *) curr + PGSIZE) - 1);
+  tid = thread_create (curr->name, PRI_DEFAULT, fork_process, &info);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  for (e = list_begin (&curr->child_list); e != list_end (&curr->child_list);
+       e = list_next (e))
+    {
+      child = list_entry (e, struct thread, child_elem);
+      if (child->tid == tid)
+        break;
+    }
+
+  /* INFO lives on our stack until the child is done with it. */
+  sema_down (&child->child_load_sema);
+  if (child->load_check == 0)
+    {
+      process_wait (tid);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
+/* A thread function that copies the process that forked it and
+   makes the copy start running. */
+static void
+fork_process (void *info_)
+{
+  struct fork_info *info = info_;
+  struct thread *curr = thread_current ();
+  struct thread *parent = info->parent;
+  struct intr_frame if_ = info->if_;
+  bool success = false;
+
+  page_init ();
+  curr->pagedir = pagedir_create ();
+  if (curr->pagedir == NULL)
+    goto done;
+  process_activate ();
+
+  if (!page_fork (parent) || !fork_stack (parent) || !fork_files (parent))
+    goto done;
+  curr->mapid = parent->mapid;
+  if_.eax = 0;
+  success = true;
+
+ done:
+  curr->load_check = success;
+  sema_up (&curr->child_load_sema);
+  if (!success)
+    thread_exit ();
+
+  /* Start the child the way start_process() starts a process. */
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* setup_stack() maps the first stack page without a
+   supplemental page table entry, so page_fork() does not see it.
+   Copies it from PARENT into the running thread. */
+static bool
+fork_stack (struct thread *parent)
+{
+  uint8_t *upage = (uint8_t *) PHYS_BASE - PGSIZE;
+  void *parent_kpage, *kpage;
+
+  parent_kpage = pagedir_get_page (parent->pagedir, upage);
+  if (parent_kpage == NULL || spte_find (upage) != NULL)
+    return true;
+
+  kpage = palloc_get_page (PAL_USER);
+  while (kpage == NULL && swap_out ())
+    kpage = palloc_get_page (PAL_USER);
+  if (kpage == NULL)
+    return false;
+  memcpy (kpage, parent_kpage, PGSIZE);
+  if (!install_page (upage, kpage, true))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+}
+
+/* Gives the running thread PARENT's file descriptors, each on a
+   new file opened at the same position. */
+static bool
+fork_files (struct thread *parent)
+{
+  struct thread *curr = thread_current ();
+  struct list_elem *e;
+
+  for (e = list_begin (&parent->fd_list); e != list_end (&parent->fd_list);
+       e = list_next (e))
+    {
+      struct file_info *p = list_entry (e, struct file_info, elem);
+      struct file_info *c = palloc_get_page (0);
+      if (c == NULL)
+        return false;
+      c->fd = p->fd;
+      c->file = file_reopen (p->file);
+      if (c->file == NULL)
+        {
+          palloc_free_page (c);
+          return false;
+        }
+      file_seek (c->file, file_tell (p->file));
+      list_push_back (&curr->fd_list, &c->elem);
+    }
+  curr->user_fd = parent->user_fd;
+  return true;
+}
+
 void push_stack_arguments(char* file_name, char* file_arguments, void **esp){
 
   // Calculate argc
@@ -311,6 +450,13 @@ process_exit (void)
   // ummap 과정
   mummap_all();
 
+  /* Take every frame out of the frame table before its page table
+     entries go away, dropping our references to shared frames so
+     that pagedir_destroy() frees only our own pages. */
+  frame_free_mapping_with_curr_thread (curr);
+  if (curr->pagedir != NULL)
+    page_destroy ();
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = curr->pagedir;
@@ -458,8 +604,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
   }
   
   /* Open executable file. */
-  lock_acquire(&file_lock);
+  lock_acquire(&dir_lock);
   file = filesys_open (file_name_only);
+  lock_release(&dir_lock);
   if (file == NULL) 
     {
       printf ("load: %s: open failed\n", file_name);
@@ -550,7 +697,6 @@ load (const char *file_name, void (**eip) (void), void **esp)
 
  done:
   palloc_free_page(file_name_only);
-  lock_release(&file_lock);
   return success;
 }
 
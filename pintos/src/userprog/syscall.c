@@ -1,28 +1,37 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/exception.h"
+#include "userprog/process.h"
 #include "threads/init.h"
 #include "vm/page.h"
 #include "vm/frame.h"
 #include "vm/swap.h"
+#include "vm/share.h"
 #include "threads/palloc.h"
+#include "threads/malloc.h"
 #include "filesys/inode.h"
 #include "filesys/filesys.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
 
 #define READDIR_MAX_LEN 14
 
 static void syscall_handler (struct intr_frame *);
 int sys_write(int fd, const void *buffer, unsigned size);
 void* valid_pointer(void *ptr);
-
-struct lock file_lock;
+static void valid_buffer (const void *buffer, unsigned size, bool write);
+static struct file_info *find_file_info (int fd);
+static bool valid_range (unsigned offset, unsigned size);
+static struct iovec *copy_in_iovec (const struct iovec *uiov, int iovcnt, bool write);
 
 bool need_stack_grow_in_syscall (void *fault_addr)
 {
@@ -36,7 +45,6 @@ void
 syscall_init (void) 
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
-  lock_init(&file_lock);
 }
 
 static void
@@ -184,7 +192,73 @@ syscall_handler (struct intr_frame *f UNUSED)
       f->eax = readdir(*valid_fd, (char *)*valid_name_addr);
       break;
     }
+    case SYS_PREAD:
+    {
+      int *valid_fd = (int*)valid_pointer((void*)(f->esp+4));
+      int *valid_buffer_addr = (int *)valid_pointer((void*)(f->esp+8));
+      int *valid_size = (int *)valid_pointer((void*)(f->esp+12));
+      int *valid_offset = (int *)valid_pointer((void*)(f->esp+16));
+      f->eax = pread(*valid_fd, (void *)*valid_buffer_addr, (unsigned)*valid_size, (unsigned)*valid_offset);
+      break;
+    }
+    case SYS_PWRITE:
+    {
+      int *valid_fd = (int*)valid_pointer((void*)(f->esp+4));
+      int *valid_buffer_addr = (int *)valid_pointer((void*)(f->esp+8));
+      int *valid_size = (int *)valid_pointer((void*)(f->esp+12));
+      int *valid_offset = (int *)valid_pointer((void*)(f->esp+16));
+      f->eax = pwrite(*valid_fd, (const void *)*valid_buffer_addr, (unsigned)*valid_size, (unsigned)*valid_offset);
+      break;
+    }
+    case SYS_READV:
+    {
+      int *valid_fd = (int*)valid_pointer((void*)(f->esp+4));
+      int *valid_iov_addr = (int *)valid_pointer((void*)(f->esp+8));
+      int *valid_iovcnt = (int *)valid_pointer((void*)(f->esp+12));
+      f->eax = readv(*valid_fd, (const struct iovec *)*valid_iov_addr, *valid_iovcnt);
+      break;
+    }
+    case SYS_WRITEV:
+    {
+      int *valid_fd = (int*)valid_pointer((void*)(f->esp+4));
+      int *valid_iov_addr = (int *)valid_pointer((void*)(f->esp+8));
+      int *valid_iovcnt = (int *)valid_pointer((void*)(f->esp+12));
+      f->eax = writev(*valid_fd, (const struct iovec *)*valid_iov_addr, *valid_iovcnt);
+      break;
+    }
+    case SYS_COPY_FILE_RANGE:
+    {
+      int *valid_in_fd = (int*)valid_pointer((void*)(f->esp+4));
+      int *valid_out_fd = (int*)valid_pointer((void*)(f->esp+8));
+      unsigned *valid_length = (unsigned *)valid_pointer((void*)(f->esp+12));
+      f->eax = copy_file_range(*valid_in_fd, *valid_out_fd, *valid_length);
+      break;
+    }
+    case SYS_CLONE:
+    {
+      int *valid_file_addr = (int *)valid_pointer((void *)(f->esp+4));
+      valid_pointer((void *)*valid_file_addr);
+      int *valid_new_file_addr = (int *)valid_pointer((void *)(f->esp+8));
+      valid_pointer((void *)*valid_new_file_addr);
+      f->eax = clone((const char *)*valid_file_addr, (const char *)*valid_new_file_addr);
+      break;
+    }
+    case SYS_DISK_STATS:
+    {
+      int *valid_chan_no = (int *)valid_pointer((void *)(f->esp+4));
+      int *valid_dev_no = (int *)valid_pointer((void *)(f->esp+8));
+      int *valid_stats_addr = (int *)valid_pointer((void *)(f->esp+12));
+      f->eax = disk_stats(*valid_chan_no, *valid_dev_no, (struct disk_stats *)*valid_stats_addr);
+      break;
+    }
+    case SYS_UPTIME:
+      f->eax = uptime();
+      break;
+    case SYS_FORK:
+      f->eax = fork();
+      break;
   }
+  frame_unpin_all();
 }
 
 void* valid_pointer(void *ptr) {
@@ -199,8 +273,15 @@ void* valid_pointer(void *ptr) {
 
   void *upage = pg_round_down (ptr);
 
+  /* Read-only text pages are shared between processes */
+  struct sup_page_table_entry *text_spte = spte_find(upage);
+  if (text_spte != NULL && share_is_shareable(text_spte)
+      && pagedir_get_page(curr->pagedir, ptr) == NULL) {
+    if (!share_page_in(text_spte, true)) exit(-1);
+    fault_around(text_spte);
+  }
   // // Map page with frame
-  if (spte_find(upage) && pagedir_get_page(curr->pagedir, ptr) == NULL) { 
+  else if (spte_find(upage) && pagedir_get_page(curr->pagedir, ptr) == NULL) { 
     if (ptr > 0x90000000) {
       exit(-1);
     }
@@ -214,19 +295,19 @@ void* valid_pointer(void *ptr) {
       kpage = palloc_get_page (PAL_USER | PAL_ZERO);
 
     /* Have kpage to allocate frame */
-    if (kpage != NULL) {
+    if (kpage != NULL && find_spte->is_mapped) {
+      /* Evicted before: bring it back from swap or its file */
+      if (!swap_in(upage, kpage)) free_kpage_and_exit(kpage);
+    }
+    else if (kpage != NULL) {
       /* Lazy loading */
       load_file_lazily(kpage, find_spte);
 
       /* Add kpage to frame */
-      struct frame_table_entry *new_fte = allocate_frame(kpage, find_spte);
-      if (new_fte == NULL) free_kpage_and_exit(kpage);
-      if (install_page(upage, kpage, find_spte->writable)) {
-        find_spte->frame = kpage;
-        find_spte->is_in_frame = 1;
-      } else {
+      if (!frame_install(find_spte, kpage, find_spte->writable))
         free_kpage_and_exit(kpage);
-      }
+      if (find_spte->page_read_bytes != 0)
+        fault_around(find_spte);
     }
     else { /* Frame eviction is needed */
       if (!find_spte->is_mapped) {
@@ -245,14 +326,8 @@ void* valid_pointer(void *ptr) {
         }
         load_file_lazily(kpage, find_spte);
 
-        struct frame_table_entry *new_fte = allocate_frame(kpage, find_spte);
-        if (new_fte == NULL) free_kpage_and_exit(kpage);
-        if (install_page(upage, kpage, find_spte->writable)) {
-          find_spte->frame = kpage;
-          find_spte->is_in_frame = 1;
-        } else {
+        if (!frame_install(find_spte, kpage, find_spte->writable))
           free_kpage_and_exit(kpage);
-        }
       }
       else { /* page data is in swap or file */
         kpage = evict_frame(upage);
@@ -275,6 +350,73 @@ void* valid_pointer(void *ptr) {
   return ptr;
 }
 
+/* Checks every page of the SIZE-byte user BUFFER with
+   valid_pointer(), faulting each one in, and pins it in its
+   frame until the system call returns, so that the file system
+   never faults on it while holding an inode lock or cache_lock.
+   If the kernel is going to WRITE the buffer, copy-on-write
+   pages are copied now as well.  A buffer that runs past
+   PHYS_BASE exits before any page is checked, since the end of
+   such a buffer could wrap around. */
+static void
+valid_buffer (const void *buffer, unsigned size, bool write)
+{
+  const void *upage;
+
+  if (size == 0)
+    return;
+  if (!is_user_vaddr (buffer)
+      || size > (uintptr_t) PHYS_BASE - (uintptr_t) buffer)
+    exit(-1);
+  for (upage = pg_round_down (buffer); upage < buffer + size; upage += PGSIZE)
+  {
+    void *p = (void *) (upage < buffer ? buffer : upage);
+    do
+      valid_pointer (p);
+    while (!frame_pin (pg_round_down (p), write));
+  }
+}
+
+/* Validates the user array of IOVCNT iovecs at UIOV and every
+   buffer it describes, which the kernel is going to WRITE or
+   read, then returns a kernel copy of the array that the caller
+   must free().  Returns a null pointer if IOVCNT is out of range
+   or memory is short. */
+static struct iovec *
+copy_in_iovec (const struct iovec *uiov, int iovcnt, bool write)
+{
+  struct iovec *iov;
+  int i;
+
+  if (iovcnt <= 0 || iovcnt > IOV_MAX)
+    return NULL;
+  valid_buffer(uiov, iovcnt * sizeof *uiov, false);
+  iov = malloc(iovcnt * sizeof *iov);
+  if (iov == NULL)
+    return NULL;
+  memcpy(iov, uiov, iovcnt * sizeof *iov);
+  for (i = 0; i < iovcnt; i++)
+    valid_buffer(iov[i].iov_base, iov[i].iov_len, write);
+  return iov;
+}
+
+/* Returns the current thread's open file entry for FD, or a null
+   pointer if FD is not open. */
+static struct file_info *
+find_file_info (int fd)
+{
+  struct thread *curr = thread_current();
+  struct list_elem *e;
+
+  for (e = list_begin(&curr->fd_list); e != list_end(&curr->fd_list); e = list_next(e))
+  {
+    struct file_info *fd_info = list_entry(e, struct file_info, elem);
+    if (fd_info->fd == fd)
+      return fd_info;
+  }
+  return NULL;
+}
+
 void exit (int status)
 {
   struct thread *curr_thread = thread_current();
@@ -298,15 +440,19 @@ int wait (pid_t pid)
 bool create (const char *file, unsigned initial_size)
 {
   bool return_value;
-  lock_acquire(&file_lock);
+  lock_acquire(&dir_lock);
   return_value = filesys_create (file, initial_size); 
-  lock_release(&file_lock);
+  lock_release(&dir_lock);
   return return_value;
 }
 
 bool remove (const char *file)
 {
-  return filesys_remove(file);
+  bool return_value;
+  lock_acquire(&dir_lock);
+  return_value = filesys_remove(file);
+  lock_release(&dir_lock);
+  return return_value;
 }
 
 int open (const char *file)
@@ -320,9 +466,9 @@ int open (const char *file)
     return -1;
   }
 
-  lock_acquire(&file_lock);
+  lock_acquire(&dir_lock);
   struct file *new_file = filesys_open(file);
-  lock_release(&file_lock);
+  lock_release(&dir_lock);
 
   // printf("after open!\n");
 
@@ -344,11 +490,9 @@ int open (const char *file)
 int filesize (int fd) 
 {
   //
-  lock_acquire(&file_lock);
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -362,36 +506,30 @@ int filesize (int fd)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
   int file_size = file_length(fd_info->file);
-  lock_release(&file_lock);
   return file_size;
 }
 
 int read (int fd, void *buffer, unsigned size)
 {
   //
-  int i;
-  for(i=1;i<size/4096 + 1;i++)
-    valid_pointer((void *)(buffer + i * 4096));
-    
-  lock_acquire(&file_lock);
+  valid_buffer(buffer, size, true);
 
+  /* Console input needs no file system lock; input_getc()
+     synchronizes with the keyboard and serial drivers itself. */
   if (fd==0) {
     int i;
     for (i=0; i < size; i++) {
       *((char *)buffer++) = input_getc();
     }
-    lock_release(&file_lock);
     return size;
   }
 
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -405,31 +543,24 @@ int read (int fd, void *buffer, unsigned size)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
   int num_read = file_read(fd_info->file, buffer, size);
-  lock_release(&file_lock);
   return num_read;
 }
 
 int write (int fd, const void *buffer, unsigned length)
 {
-  int i;
   int num_write = -1;
-  for(i=1;i<length/4096 + 1;i++)
-    valid_pointer((void *)(buffer + i * 4096));
+  valid_buffer(buffer, length, false);
 
-  lock_acquire(&file_lock);
   if (fd == 1) {
     putbuf(buffer, length);
-    lock_release(&file_lock);
     return length;
   }
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -443,7 +574,6 @@ int write (int fd, const void *buffer, unsigned length)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
 
@@ -452,8 +582,6 @@ int write (int fd, const void *buffer, unsigned length)
     // printf("inode is dir %d\n", inode_isdir(file_get_inode(fd_info->file)));
     num_write = file_write(fd_info->file, buffer, length);
   }
-    
-  lock_release(&file_lock);
 
   return num_write;
 }
@@ -461,11 +589,9 @@ int write (int fd, const void *buffer, unsigned length)
 void seek (int fd, unsigned position) 
 {
   //
-  lock_acquire(&file_lock);
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -479,21 +605,17 @@ void seek (int fd, unsigned position)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
   file_seek(fd_info->file, position);
-  lock_release(&file_lock);
 }
 
 unsigned tell (int fd) 
 {
   //
-  lock_acquire(&file_lock);
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -507,23 +629,19 @@ unsigned tell (int fd)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
   unsigned position = file_tell(fd_info->file);
-  lock_release(&file_lock);
   return position;
 }
 
 void close (int fd)
 {
-  lock_acquire(&file_lock);
   int has_fd = 0;
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
 
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     exit(-1);
   }
   struct file_info *fd_info;
@@ -541,22 +659,18 @@ void close (int fd)
   file_close(fd_info->file);
   list_remove(&fd_info->elem);
   palloc_free_page(fd_info);
-  lock_release(&file_lock);
 }
 
 mapid_t mmap(int fd, void *addr)
 {
-  // lock_acquire(&file_lock);
   /* Handling fail case: file descriptors is 0 or 1. */
   if (fd == 0 || fd == 1) {
-    // lock_release(&file_lock);
     return -1;
   }
   /* Find fd in the current thread's file list */
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    // lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -570,10 +684,8 @@ mapid_t mmap(int fd, void *addr)
     }
   }
   if (find == 0) {
-    // lock_release(&file_lock);
     return -1;
   }
-  lock_acquire(&file_lock);
   struct file *file = file_reopen(fd_info->file);
   /* Handling exit(-1) case
   1. file has zero bytes
@@ -581,7 +693,6 @@ mapid_t mmap(int fd, void *addr)
   3. addr is 0 
   4. addr is in stack segment(not loaded, but stack grow regin */
   if (file_length(file) == 0 || pg_ofs(addr) != 0 || addr == 0 || !is_user_vaddr(addr) || addr >= 0x90000000) {
-    lock_release(&file_lock);
     return -1;
   }
 
@@ -603,7 +714,6 @@ mapid_t mmap(int fd, void *addr)
     struct sup_page_table_entry *find_spte = spte_find(upage);
   
     if (find_spte != NULL) {
-      lock_release(&file_lock);
       return -1;
     }
     // (void *addr, void *frame, bool is_in_frame, bool is_in_swap, struct file *file, off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, bool from_load);
@@ -624,7 +734,6 @@ mapid_t mmap(int fd, void *addr)
     upage += PGSIZE;
     ofs += page_read_bytes;
   }
-  lock_release(&file_lock);
   return return_mapid;
 }
   
@@ -638,7 +747,6 @@ void munmap(mapid_t mapid)
 
   if (list_empty(&curr->mfile_list)) return;
 
-  lock_acquire(&file_lock);
   for (e=list_begin(&curr->mfile_list); e != list_tail(&curr->mfile_list); e = next)
   {
     next = list_next(e);
@@ -668,7 +776,6 @@ void munmap(mapid_t mapid)
       free(find_mfile);
     }
   }
-  lock_release(&file_lock);
 }
 
 void mummap_all()
@@ -680,8 +787,6 @@ void mummap_all()
 
   if (list_empty(&curr->mfile_list)) return;
 
-  lock_acquire(&file_lock);
-
   for (e=list_begin(&curr->mfile_list); e != list_tail(&curr->mfile_list); e = next)
   {
     next = list_next(e);
@@ -710,11 +815,6 @@ void mummap_all()
     }
     free(find_mfile);
   }
-  lock_release(&file_lock);
-
-
-  // frame table mapping을 지워주기
-  frame_free_mapping_with_curr_thread(curr);
 }
 
 bool mkdir(const char *dir)
@@ -723,7 +823,7 @@ bool mkdir(const char *dir)
     return false;
   }
   bool return_value;
-  lock_acquire (&file_lock);
+  lock_acquire (&dir_lock);
 
   return_value = filesys_create(dir, 0);
   
@@ -732,15 +832,15 @@ bool mkdir(const char *dir)
   struct inode *inode;
   if (!dir_lookup(file_dir, name, &inode)) {
     dir_close(file_dir);
+    lock_release (&dir_lock);
     return false;
   }
-  inode->isdir = 1;
-  inode->parent = inode_get_inumber(dir_get_inode(file_dir));
+  inode_set_dir(inode, inode_get_inumber(dir_get_inode(file_dir)));
   inode->path = dir;
   // printf("child's parent sector is %zu\n", inode->parent);
   // printf("inode open count %d\n", inode->open_cnt);
   // inode_close(inode); // for dir_lookup  <<<<<<<<<<<<<<<<<<<<<<<<< 생각해보기
-  lock_release (&file_lock);
+  lock_release (&dir_lock);
   
   // printf("dir open cnt %d\n", inode_open_cnt(dir_get_inode(file_dir)));
 
@@ -751,7 +851,7 @@ bool mkdir(const char *dir)
 
 bool chdir(const char *dir)
 {
-  lock_acquire(&file_lock);
+  lock_acquire(&dir_lock);
 
   struct dir *file_dir = get_dir(dir);
   struct dir *final_dir;
@@ -783,7 +883,7 @@ bool chdir(const char *dir)
   {
     if(!dir_lookup(file_dir, name, &inode))
     {
-      lock_release(&file_lock);
+      lock_release(&dir_lock);
       return false;
     }
     final_dir = dir_open(inode);
@@ -792,18 +892,16 @@ bool chdir(const char *dir)
   }
 
   dir_close(file_dir);
-  lock_release(&file_lock);
+  lock_release(&dir_lock);
   return true;
 }
 
 bool isdir (int fd)
 {
-  lock_acquire(&file_lock);
   bool return_value;
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return false;
   }
   struct file_info *fd_info;
@@ -817,23 +915,19 @@ bool isdir (int fd)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return false;
   }
 
   return_value = inode_isdir(file_get_inode(fd_info->file));
-  lock_release(&file_lock);
   return return_value;
 }
 
 int inumber (int fd)
 {
-  lock_acquire(&file_lock);
   int return_value;
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
     return -1;
   }
   struct file_info *fd_info;
@@ -847,26 +941,24 @@ int inumber (int fd)
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
     return -1;
   }
 
   // printf("fd is %d, fd_info->file %08x, inode %08x, inumber %d\n",fd, fd_info->file, file_get_inode(fd_info->file), inode_get_inumber(file_get_inode(fd_info->file)));
 
   return_value = inode_get_inumber(file_get_inode(fd_info->file));
-  lock_release(&file_lock);
   return return_value;
 }
 
 bool
 readdir (int fd, char name[READDIR_MAX_LEN + 1]) 
 {
-  lock_acquire(&file_lock);
+  lock_acquire(&dir_lock);
   bool return_value;
   struct thread *curr = thread_current();
   struct list_elem *e, *next;
   if (list_empty(&curr->fd_list)) {
-    lock_release(&file_lock);
+    lock_release(&dir_lock);
     return false;
   }
   struct file_info *fd_info;
@@ -880,13 +972,13 @@ readdir (int fd, char name[READDIR_MAX_LEN + 1])
     }
   }
   if (find == 0) {
-    lock_release(&file_lock);
+    lock_release(&dir_lock);
     return false;
   }
 
   struct inode *inode = file_get_inode(fd_info->file);
   if (!inode_isdir(inode)) {
-    lock_release(&file_lock);
+    lock_release(&dir_lock);
     return false;
   }
 
@@ -896,6 +988,171 @@ readdir (int fd, char name[READDIR_MAX_LEN + 1])
   struct dir *open_dir = (struct dir*)fd_info->file;
   return_value = dir_readdir(open_dir, name);
 
-  lock_release(&file_lock);
+  lock_release(&dir_lock);
   return return_value;
-}
\ No newline at end of file
+}
+
+/* Returns true if bytes OFFSET through OFFSET + SIZE all fit in
+   an off_t, so that a file offset from user space cannot wrap
+   negative. */
+static bool
+valid_range (unsigned offset, unsigned size)
+{
+  return offset <= INT32_MAX && size <= INT32_MAX - offset;
+}
+
+/* Reads SIZE bytes from FD at byte OFFSET without using or moving
+   the file position, so several threads can read one file
+   without a seek() in between. */
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct file_info *fd_info;
+
+  valid_buffer(buffer, size, true);
+  fd_info = find_file_info(fd);
+  if (fd_info == NULL || !valid_range(offset, size))
+    return -1;
+  return file_read_at(fd_info->file, buffer, size, offset);
+}
+
+/* Writes SIZE bytes to FD at byte OFFSET, extending the file if
+   needed, without using or moving the file position. */
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  struct file_info *fd_info;
+
+  valid_buffer(buffer, size, false);
+  fd_info = find_file_info(fd);
+  if (fd_info == NULL || inode_isdir(file_get_inode(fd_info->file))
+      || !valid_range(offset, size))
+    return -1;
+  return file_write_at(fd_info->file, buffer, size, offset);
+}
+
+/* Reads from FD into the IOVCNT buffers described by IOV, in
+   order, as one transfer from the current file position. */
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct iovec *kiov = copy_in_iovec(iov, iovcnt, true);
+  struct file_info *fd_info;
+  int num_read = -1;
+
+  if (kiov == NULL)
+    return -1;
+
+  if (fd == 0)
+  {
+    int i;
+    unsigned j;
+    num_read = 0;
+    for (i = 0; i < iovcnt; i++)
+      for (j = 0; j < kiov[i].iov_len; j++)
+        ((char *)kiov[i].iov_base)[j] = input_getc();
+    for (i = 0; i < iovcnt; i++)
+      num_read += kiov[i].iov_len;
+  }
+  else if ((fd_info = find_file_info(fd)) != NULL)
+    num_read = file_readv(fd_info->file, kiov, iovcnt);
+
+  free(kiov);
+  return num_read;
+}
+
+/* Writes the IOVCNT buffers described by IOV to FD, in order, as
+   one transfer at the current file position.  Record writers can
+   hand a header and its payload to the kernel in a single call. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  struct iovec *kiov = copy_in_iovec(iov, iovcnt, false);
+  struct file_info *fd_info;
+  int num_write = -1;
+
+  if (kiov == NULL)
+    return -1;
+
+  if (fd == 1)
+  {
+    int i;
+    num_write = 0;
+    for (i = 0; i < iovcnt; i++)
+    {
+      putbuf(kiov[i].iov_base, kiov[i].iov_len);
+      num_write += kiov[i].iov_len;
+    }
+  }
+  else if ((fd_info = find_file_info(fd)) != NULL
+           && !inode_isdir(file_get_inode(fd_info->file)))
+    num_write = file_writev(fd_info->file, kiov, iovcnt);
+
+  free(kiov);
+  return num_write;
+}
+
+/* Copies up to LENGTH bytes from IN_FD to OUT_FD, at each file's
+   current position, without bouncing the data through user
+   memory.  Returns the number of bytes copied, or -1 if either
+   descriptor is bad or refers to a directory. */
+int
+copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+  struct file_info *in_info = find_file_info(in_fd);
+  struct file_info *out_info = find_file_info(out_fd);
+
+  if (in_info == NULL || out_info == NULL
+      || inode_isdir(file_get_inode(in_info->file))
+      || inode_isdir(file_get_inode(out_info->file)))
+    return -1;
+  if (length > INT32_MAX)
+    length = INT32_MAX;
+  return file_copy_range(in_info->file, out_info->file, length);
+}
+
+/* Creates NEW_FILE as a copy-on-write clone of FILE. */
+bool
+clone (const char *file, const char *new_file)
+{
+  bool return_value;
+  lock_acquire(&dir_lock);
+  return_value = filesys_clone(file, new_file);
+  lock_release(&dir_lock);
+  return return_value;
+}
+
+/* Copies the I/O statistics of disk DEV_NO on channel CHAN_NO
+   into *STATS.  Returns false if there is no such disk. */
+bool
+disk_stats (int chan_no, int dev_no, struct disk_stats *stats)
+{
+  struct disk *d;
+  struct disk_stats st;
+
+  valid_buffer(stats, sizeof *stats, true);
+  if (chan_no < 0 || (dev_no != 0 && dev_no != 1))
+    return false;
+  d = disk_get(chan_no, dev_no);
+  if (d == NULL)
+    return false;
+  disk_get_stats(d, &st);
+  memcpy(stats, &st, sizeof st);
+  return true;
+}
+
+/* Returns the number of timer ticks since the OS booted. */
+long
+uptime (void)
+{
+  return timer_ticks();
+}
+
+/* Creates a copy of the running process that resumes from the
+   same system call, returning 0 in the child and the child's
+   pid in the parent, or -1 if the child cannot be created. */
+pid_t
+fork (void)
+{
+  return process_fork();
+}
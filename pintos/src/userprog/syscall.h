@@ -1,13 +1,13 @@
 #include <stdio.h>
 #include <stdbool.h>
+#include <disk-stats.h>
+#include <iovec.h>
 
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
 typedef int pid_t;
 
-struct lock file_lock;
-
 void syscall_init (void);
 
 //
@@ -32,5 +32,14 @@ bool chdir(const char *dir);
 bool readdir(int fd, char *name);
 bool isdir (int fd);
 int inumber(int fd);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+bool clone (const char *file, const char *new_file);
+bool disk_stats (int chan_no, int dev_no, struct disk_stats *stats);
+long uptime (void);
+pid_t fork (void);
 
 #endif /* userprog/syscall.h */
@@ -3,20 +3,77 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/palloc.h"
+#include <round.h>
+#include <string.h>
+#include "userprog/pagedir.h"
+#include "vm/swap.h"
+#include "vm/share.h"
 
 static struct list frame_table;
+static size_t frame_cnt;            /* Entries in frame_table. */
+
+bool install_page (void *upage, void *kpage, bool writable);
+
+/* Frame table entries indexed by the frame's page number within
+   the user pool (palloc_user_page_idx()), NULL for frames not in
+   the table.  A shared frame has one entry per process mapping
+   it, none of which is indexed.  Protected by frame_table_lock. */
+static struct frame_table_entry **frame_index;
 struct lock frame_lock;
 struct lock frame_table_lock;
 
+/* Clock hand for eviction: the next frame delete_frame_entry()
+   looks at, or the list tail to start over from the front.
+   Protected by frame_table_lock. */
+static struct list_elem *clock_hand;
+
+/* Page-out daemon.  allocate_frame() wakes it when fewer than
+   pageout_low user frames are free, and it evicts frames until
+   pageout_high are free again, so that page faults usually find
+   a free frame instead of evicting one themselves. */
+static struct semaphore pageout_sema;
+static size_t pageout_low, pageout_high;
+
+static void pageout_daemon (void *);
+static struct list_elem *clock_advance (struct list_elem *);
+static struct frame_table_entry *frame_add (void *, struct sup_page_table_entry *,
+                                            struct shared_page *);
+static void frame_unlink (struct frame_table_entry *);
+static void frame_release (struct frame_table_entry *);
+
 /*
  * Initialize frame table
  */
 void 
 frame_init (void)
 {
+    size_t index_size = palloc_user_page_cnt() * sizeof *frame_index;
+
     list_init (&frame_table);
+    frame_index = palloc_get_multiple(PAL_ASSERT | PAL_ZERO,
+                                      DIV_ROUND_UP(index_size, PGSIZE));
+    clock_hand = list_end (&frame_table);
     lock_init(&frame_lock);
     lock_init(&frame_table_lock);
+
+    pageout_low = palloc_user_page_cnt() / 16;
+    pageout_high = palloc_user_page_cnt() / 8;
+    sema_init(&pageout_sema, 0);
+    thread_create("pageout", PRI_DEFAULT, pageout_daemon, NULL);
+}
+
+/*
+ * Keep free user frames between pageout_low and pageout_high.
+ */
+static void
+pageout_daemon (void *aux UNUSED)
+{
+    for (;;)
+    {
+        sema_down(&pageout_sema);
+        while (palloc_user_free_cnt() < pageout_high && swap_out())
+            continue;
+    }
 }
 
 
@@ -25,20 +82,135 @@ frame_init (void)
  */
 struct frame_table_entry *
 allocate_frame (void *frame, struct sup_page_table_entry *spte)
+{
+    return frame_add(frame, spte, NULL);
+}
+
+/*
+ * Map KPAGE at SPTE's page for the running thread and make a new
+ * frame table entry for it.  The page is mapped and marked in a
+ * frame before the frame table, and with it the page-out daemon,
+ * can see it, so it cannot be evicted half set up.  Returns
+ * false, with the mapping undone and KPAGE left to the caller,
+ * if it could not be mapped.
+ */
+bool
+frame_install (struct sup_page_table_entry *spte, void *kpage, bool writable)
+{
+    if (!install_page(spte->user_vaddr, kpage, writable))
+        return false;
+    spte->frame = kpage;
+    spte->is_in_frame = 1;
+    if (allocate_frame(kpage, spte) == NULL)
+    {
+        pagedir_clear_page(thread_current()->pagedir, spte->user_vaddr);
+        spte->is_in_frame = 0;
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Pin the running thread's page UPAGE, which a system call is
+ * about to access, in its frame until frame_unpin_all(), so that
+ * the kernel does not fault on it while it holds file system
+ * locks.  If WRITE, a copy-on-write page gets its private frame
+ * first, for the same reason.  Returns false if the page is not
+ * in a frame, or was just given a private one; the caller faults
+ * it in and tries again.
+ */
+bool
+frame_pin (void *upage, bool write)
+{
+    struct thread *t = thread_current();
+    struct sup_page_table_entry *spte = spte_find(upage);
+    struct frame_table_entry *fte;
+    bool cow;
+
+    /* The first stack page has no entry and is never evicted. */
+    if (spte == NULL)
+        return pagedir_get_page(t->pagedir, upage) != NULL;
+
+    lock_acquire(&frame_table_lock);
+    fte = spte->fte;
+    cow = (fte != NULL && write && spte->writable && fte->shared != NULL
+           && !share_is_text(fte->shared));
+    lock_release(&frame_table_lock);
+    if (cow && frame_cow_break(spte))
+        return false;
+
+    lock_acquire(&frame_table_lock);
+    if (spte->fte == NULL)
+    {
+        lock_release(&frame_table_lock);
+        return false;
+    }
+    if (!spte->pinned)
+    {
+        spte->pinned = 1;
+        list_push_back(&t->pinned_list, &spte->pin_elem);
+    }
+    lock_release(&frame_table_lock);
+    return true;
+}
+
+/*
+ * Unpin every page the running thread pinned with frame_pin().
+ */
+void
+frame_unpin_all (void)
+{
+    struct thread *t = thread_current();
+
+    lock_acquire(&frame_table_lock);
+    while (!list_empty(&t->pinned_list))
+    {
+        struct sup_page_table_entry *spte = list_entry(list_pop_front(&t->pinned_list),
+                                                       struct sup_page_table_entry, pin_elem);
+        spte->pinned = 0;
+    }
+    lock_release(&frame_table_lock);
+}
+
+/*
+ * Make a new frame table entry for the running thread's mapping
+ * of shared page SP at FRAME.  Evicting it drops the mapping's
+ * reference to SP.
+ */
+struct frame_table_entry *
+allocate_shared_frame (void *frame, struct sup_page_table_entry *spte, struct shared_page *sp)
+{
+    return frame_add(frame, spte, sp);
+}
+
+static struct frame_table_entry *
+frame_add (void *frame, struct sup_page_table_entry *spte, struct shared_page *sp)
 {
     lock_acquire(&frame_lock);
     struct frame_table_entry *new_fte = malloc(sizeof(struct frame_table_entry));
     if (new_fte == NULL)
+    {
+        lock_release(&frame_lock);
         return NULL;
+    }
     new_fte->frame = frame;
     new_fte->owner = thread_current();
     new_fte->spte = spte;
+    new_fte->shared = sp;
     lock_acquire(&frame_table_lock);
     list_push_back(&frame_table, &new_fte->elem);
+    frame_cnt++;
+    list_push_back(&new_fte->owner->frame_list, &new_fte->owner_elem);
+    if (sp == NULL)
+        frame_index[palloc_user_page_idx(frame)] = new_fte;
+    spte->fte = new_fte;
     lock_release(&frame_table_lock);
 
     spte->is_mapped = 1; //
     lock_release(&frame_lock);
+
+    if (palloc_user_free_cnt() < pageout_low)
+        sema_up(&pageout_sema);
     return new_fte;
 }
 
@@ -56,71 +228,275 @@ evict_frame(void *addr)
     return kpage;
 }
 
-struct hash_elem *
+/*
+ * Choose a frame to evict with the clock (second chance)
+ * algorithm and take it out of the frame table.  The hand sweeps
+ * the frame table in order; a frame whose page was accessed
+ * since the hand last passed has its accessed bit cleared and is
+ * skipped, and the first one that was not is the victim.  Frames
+ * pinned by frame_pin() are always skipped.  After one full sweep
+ * every accessed bit is clear, so this stops within two.  Returns
+ * NULL if the frame table is empty or every frame in it is
+ * pinned.
+ */
+struct list_elem *
 delete_frame_entry()
 {
+    struct list_elem *evicted_elem = NULL;
+    size_t steps;
+
     lock_acquire(&frame_table_lock);
-    struct hash_elem *evicted_elem = list_pop_front(&frame_table);
+    for (steps = 0; steps < 2 * frame_cnt; steps++)
+    {
+        if (clock_hand == list_end(&frame_table))
+            clock_hand = list_begin(&frame_table);
+
+        struct frame_table_entry *fte = list_entry(clock_hand, struct frame_table_entry, elem);
+        uint32_t *pd = fte->owner->pagedir;
+        void *upage = fte->spte->user_vaddr;
+
+        if (fte->spte->pinned)
+        {
+            clock_hand = list_next(clock_hand);
+            continue;
+        }
+        if (pd != NULL && pagedir_is_accessed(pd, upage))
+        {
+            pagedir_set_accessed(pd, upage, false);
+            clock_hand = list_next(clock_hand);
+            continue;
+        }
+
+        evicted_elem = clock_hand;
+        frame_unlink(fte);
+        break;
+    }
     lock_release(&frame_table_lock);
     return evicted_elem;
 }
 
+/* Returns where the clock hand should point once E is taken out
+   of the frame table. */
+static struct list_elem *
+clock_advance (struct list_elem *e)
+{
+    ASSERT (lock_held_by_current_thread(&frame_table_lock));
+    return clock_hand == e ? list_next(e) : clock_hand;
+}
+
+/* Takes FTE out of the frame table, the frame index and its
+   owner's frame list. */
+static void
+frame_unlink (struct frame_table_entry *fte)
+{
+    ASSERT (lock_held_by_current_thread(&frame_table_lock));
+    clock_hand = clock_advance(&fte->elem);
+    list_remove(&fte->elem);
+    frame_cnt--;
+    list_remove(&fte->owner_elem);
+    if (fte->shared == NULL)
+        frame_index[palloc_user_page_idx(fte->frame)] = NULL;
+    fte->spte->fte = NULL;
+}
+
+/* Frees FTE, which is out of the frame table, and its
+   supplemental page table entry.  A shared frame is unmapped
+   and its reference dropped here, since pagedir_destroy() would
+   otherwise free a page other processes still map. */
+static void
+frame_release (struct frame_table_entry *fte)
+{
+    if (fte->spte->pinned)
+        list_remove(&fte->spte->pin_elem);
+    if (fte->shared != NULL)
+    {
+        pagedir_clear_page(fte->owner->pagedir, fte->spte->user_vaddr);
+        share_put(fte->shared);
+    }
+    hash_delete(&fte->owner->spt, &fte->spte->hash_elem);
+    free(fte->spte);
+    free(fte);
+}
+
+/*
+ * Find the frame table entry of user page KPAGE, or NULL.
+ * Shared frames are not found.
+ */
 struct frame_table_entry *
 fte_find(void *kpage)
 {
-    struct thread *curr = thread_current();
-    struct frame_table_entry *fte; 
-    struct list_elem *e, *next;
-    lock_acquire(&frame_table_lock);
-    
-    for(e=list_begin(&frame_table);e!=list_end(&frame_table);e=next){
-        next = list_next(e);
-        fte = list_entry(e, struct frame_table_entry, elem);
-        if(fte->frame == kpage)
-            break;
-        fte = NULL;
-    }
+    struct frame_table_entry *fte;
 
-    if (fte == NULL) {
-        lock_release(&frame_table_lock);
-        return NULL;
-    }
+    lock_acquire(&frame_table_lock);
+    fte = frame_index[palloc_user_page_idx(kpage)];
     lock_release(&frame_table_lock);
     return fte;
 }
 
+/*
+ * Take the frame KPAGE out of the frame table and free its frame
+ * table entry and supplemental page table entry.  The page itself
+ * is left to the caller.
+ */
 void
 remove_frame(void *kpage)
 {
     lock_acquire(&frame_lock);
-    struct frame_table_entry *fte = fte_find(kpage);
+    lock_acquire(&frame_table_lock);
+    struct frame_table_entry *fte = frame_index[palloc_user_page_idx(kpage)];
     if (fte == NULL)
     {
+        lock_release(&frame_table_lock);
         lock_release(&frame_lock);
         return;
     }
-    lock_acquire(&frame_table_lock);
-    list_remove(&fte->elem);
+    frame_unlink(fte);
     lock_release(&frame_table_lock);
 
-    hash_delete(&fte->owner->spt, &fte->spte->hash_elem);
-    free(fte->spte);
-    free(fte);
+    frame_release(fte);
     lock_release(&frame_lock);
 }
 
-void
-frame_free_mapping_with_curr_thread(struct thread *thread) 
+/*
+ * Share the frame of PARENT's page P copy-on-write with the
+ * running thread's page C, a fresh copy of P made by fork(): both
+ * map it read-only from now on, and the first write to it in
+ * either gets a private copy from frame_cow_break().  Leaves C
+ * alone if P is not in the frame table.  Returns false if out of
+ * memory.
+ */
+bool
+frame_fork_cow (struct sup_page_table_entry *p, struct sup_page_table_entry *c)
 {
-    struct list_elem *e, *next;
+    struct frame_table_entry *fte;
+    struct shared_page *sp;
+    void *kpage;
+
+    ASSERT (!share_is_shareable(p));
 
-    for (e=list_begin(&frame_table); e != list_tail(&frame_table); e = next)
+    lock_acquire(&frame_table_lock);
+    fte = p->fte;
+    if (fte == NULL)
     {
-        next = list_next(e);
-        struct frame_table_entry *fte = list_entry(e, struct frame_table_entry, elem);
+        lock_release(&frame_table_lock);
+        return true;
+    }
+    sp = fte->shared;
+    if (sp == NULL)
+    {
+        sp = share_new_cow(fte->frame);
+        if (sp == NULL)
+        {
+            lock_release(&frame_table_lock);
+            return false;
+        }
+        fte->shared = sp;
+        frame_index[palloc_user_page_idx(fte->frame)] = NULL;
+    }
+    share_get(sp);
+    pagedir_set_writable(fte->owner->pagedir, p->user_vaddr, false);
+    kpage = fte->frame;
+    lock_release(&frame_table_lock);
+
+    /* Our reference keeps KPAGE even if P is evicted now. */
+    c->frame = kpage;
+    c->is_in_frame = 1;
+    if (!install_page(c->user_vaddr, kpage, false))
+    {
+        c->is_in_frame = 0;
+        share_put(sp);
+        return false;
+    }
+    if (allocate_shared_frame(kpage, c, sp) == NULL)
+    {
+        pagedir_clear_page(thread_current()->pagedir, c->user_vaddr);
+        c->is_in_frame = 0;
+        share_put(sp);
+        return false;
+    }
+    return true;
+}
 
-        if (fte->owner->tid == thread->tid) {
-            remove_frame(fte->frame);
+/*
+ * Give the running thread's page SPTE, mapped read-only from a
+ * copy-on-write frame, a private writable frame.  If no other
+ * process maps the frame any more, it becomes SPTE's own without
+ * a copy.  Returns false if SPTE is not copy-on-write or memory
+ * ran out; returns true without doing anything if SPTE was
+ * evicted meanwhile, in which case the access faults it back in.
+ */
+bool
+frame_cow_break (struct sup_page_table_entry *spte)
+{
+    uint32_t *pd = thread_current()->pagedir;
+    struct frame_table_entry *fte;
+    struct shared_page *sp;
+    void *kpage, *own;
+
+    kpage = palloc_get_page(PAL_USER);
+    while (kpage == NULL && swap_out())
+        kpage = palloc_get_page(PAL_USER);
+    if (kpage == NULL)
+        return false;
+
+    lock_acquire(&frame_table_lock);
+    fte = spte->fte;
+    if (fte == NULL || fte->shared == NULL || share_is_text(fte->shared))
+    {
+        lock_release(&frame_table_lock);
+        palloc_free_page(kpage);
+        return fte == NULL;
+    }
+    sp = fte->shared;
+    own = share_take(sp);
+    if (own != NULL)
+    {
+        palloc_free_page(kpage);
+        kpage = own;
+        pagedir_set_writable(pd, spte->user_vaddr, true);
+    }
+    else
+    {
+        memcpy(kpage, fte->frame, PGSIZE);
+        pagedir_clear_page(pd, spte->user_vaddr);
+        if (!pagedir_set_page(pd, spte->user_vaddr, kpage, true))
+            PANIC ("frame_cow_break: cannot remap %p", spte->user_vaddr);
+    }
+    fte->frame = kpage;
+    fte->shared = NULL;
+    frame_index[palloc_user_page_idx(kpage)] = fte;
+    spte->frame = kpage;
+    lock_release(&frame_table_lock);
+
+    if (own == NULL)
+        share_put(sp);
+    return true;
+}
+
+/*
+ * Remove every frame THREAD owns from the frame table.  Only
+ * THREAD's own frame list is walked.
+ */
+void
+frame_free_mapping_with_curr_thread(struct thread *thread) 
+{
+    for (;;)
+    {
+        lock_acquire(&frame_lock);
+        lock_acquire(&frame_table_lock);
+        if (list_empty(&thread->frame_list))
+        {
+            lock_release(&frame_table_lock);
+            lock_release(&frame_lock);
+            break;
         }
+        struct frame_table_entry *fte = list_entry(list_front(&thread->frame_list),
+                                                   struct frame_table_entry, owner_elem);
+        frame_unlink(fte);
+        lock_release(&frame_table_lock);
+
+        frame_release(fte);
+        lock_release(&frame_lock);
     }
 }
+/* This is 2016 spring cs330 skeleton code */
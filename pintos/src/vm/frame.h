@@ -6,17 +6,31 @@
 #ifndef VM_FRAME_H
 #define VM_FRAME_H
 
+struct shared_page;
+
 struct frame_table_entry
 {
 	uint32_t* frame;
 	struct thread* owner;
 	struct sup_page_table_entry* spte;
 
-	struct list_elem elem;
+	struct list_elem elem;        /* frame_table (clock order). */
+	struct list_elem owner_elem;  /* owner->frame_list. */
+	struct shared_page *shared;   /* Shared text page, or NULL. */
 };
 
 void frame_init (void);
 struct frame_table_entry * allocate_frame (void *frame, struct sup_page_table_entry *spte);
+bool frame_install (struct sup_page_table_entry *spte, void *kpage, bool writable);
+bool frame_pin (void *upage, bool write);
+void frame_unpin_all (void);
+struct frame_table_entry * allocate_shared_frame (void *frame, struct sup_page_table_entry *spte, struct shared_page *);
+struct list_elem *delete_frame_entry (void);
+struct frame_table_entry *fte_find (void *kpage);
+void remove_frame (void *kpage);
+bool frame_fork_cow (struct sup_page_table_entry *p, struct sup_page_table_entry *c);
+bool frame_cow_break (struct sup_page_table_entry *spte);
+void frame_free_mapping_with_curr_thread (struct thread *);
 
 
 #endif /* vm/frame.h */
@@ -1,6 +1,9 @@
 #include "vm/page.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "vm/share.h"
 
 
 /*
@@ -28,6 +31,10 @@ allocate_page (void *addr, void *frame, bool is_in_frame, bool is_in_swap, struc
     spte->is_in_frame = is_in_frame;
     spte->is_in_swap = is_in_swap;
     spte->is_mapped = 0;
+    spte->swapping_out = 0;
+    spte->is_in_zswap = 0;
+    spte->pinned = 0;
+    spte->fte = NULL;
 
     spte->file = file;
     spte->page_read_bytes = page_read_bytes;
@@ -44,27 +51,84 @@ allocate_page (void *addr, void *frame, bool is_in_frame, bool is_in_swap, struc
     return spte;
 }
 
+/*
+ * Find the running thread's spte for the page that contains addr.
+ * Returns NULL if there is none.
+ */
 struct sup_page_table_entry *
 spte_find(void *addr)
 {
-    struct thread *curr = thread_current();
+    struct sup_page_table_entry key;
+    struct hash_elem *e;
+
+    key.user_vaddr = pg_round_down(addr);
+    e = hash_find(&thread_current()->spt, &key.hash_elem);
+    if (e == NULL)
+        return NULL;
+    return hash_entry(e, struct sup_page_table_entry, hash_elem);
+}
+
+/*
+ * Copy PARENT's supplemental page table into the running thread's
+ * for fork().  Pages in a frame are shared copy-on-write, pages in
+ * swap get their own slot, and pages not loaded yet (and read-only
+ * executable pages, which are shared anyway) stay lazy.  Memory
+ * mappings are not inherited.  PARENT must be waiting for the
+ * fork.  Returns false if out of memory or swap.
+ */
+bool
+page_fork (struct thread *parent)
+{
     struct hash_iterator i;
-    struct sup_page_table_entry *spte; 
-    hash_first (&i, &curr->spt);
 
-    while (hash_next (&i)) //find spte
+    hash_first(&i, &parent->spt);
+    while (hash_next(&i))
     {
-        spte = hash_entry (hash_cur (&i), struct sup_page_table_entry, hash_elem);
-        if(spte->user_vaddr == addr){
-            // printf("spte->user_vaddr %08x, addr is %08x\n", spte->user_vaddr, addr);
-            break;
+        struct sup_page_table_entry *p = hash_entry(hash_cur(&i), struct sup_page_table_entry, hash_elem);
+        struct sup_page_table_entry *c;
+
+        if (!p->from_load && p->file != NULL)
+            continue;
+        c = allocate_page(p->user_vaddr, NULL, 0, p->is_in_swap, p->file, p->ofs,
+                          p->page_read_bytes, p->page_zero_bytes, p->writable, p->from_load);
+        if (c == NULL)
+            return false;
+        if (!p->is_mapped || share_is_shareable(p))
+            continue;
+
+        /* P may be on its way from a frame to swap; wait it out. */
+        for (;;)
+        {
+            if (!frame_fork_cow(p, c))
+                return false;
+            if (c->is_in_frame)
+                break;
+            if (!swap_fork(p, c))
+                return false;
+            if (c->is_mapped)
+                break;
+            thread_yield();
         }
-        spte = NULL;
     }
+    return true;
+}
 
-    if (spte == NULL) 
-        return NULL;
-    return spte;
+static void
+page_destroy_func (struct hash_elem *e, void *aux UNUSED)
+{
+    swap_free(hash_entry(e, struct sup_page_table_entry, hash_elem));
+}
+
+/*
+ * Free the running thread's supplemental page table on exit,
+ * along with the swap slots and compressed swap entries of its
+ * pages.  Pages in a frame must already have been released by
+ * frame_free_mapping_with_curr_thread().
+ */
+void
+page_destroy (void)
+{
+    hash_destroy(&thread_current()->spt, page_destroy_func);
 }
 
 uint32_t spt_hash_func(struct hash_elem *e) {
@@ -7,6 +7,9 @@
 #ifndef VM_PAGE_H
 #define VM_PAGE_H
 
+struct thread;
+struct frame_table_entry;
+
 struct sup_page_table_entry 
 {
 	uint32_t* user_vaddr;
@@ -20,7 +23,12 @@ struct sup_page_table_entry
 	bool is_in_frame;
 	bool is_in_swap; // 1이면 swap에, 0이면 file에
 	bool is_mapped; // frame과 mapping 된 적이 있었냐
+	bool swapping_out;              /* Being written out by swap_out(). */
 	size_t bit_index;
+	bool is_in_zswap;               /* bit_index names a zswap entry. */
+	struct frame_table_entry *fte;  /* While in the frame table (frame_table_lock). */
+	bool pinned;                    /* Not evicted; see frame_pin(). */
+	struct list_elem pin_elem;      /* Owner's pinned_list. */
 	struct hash_elem hash_elem;
 
 	struct file *file;
@@ -33,6 +41,9 @@ struct sup_page_table_entry
 
 void page_init (void);
 struct sup_page_table_entry *allocate_page (void *addr, void *frame, bool is_in_frame, bool is_in_swap, struct file *file, off_t ofs, size_t page_read_bytes, size_t page_zero_bytes, bool writable, bool from_load);
+struct sup_page_table_entry *spte_find (void *addr);
+bool page_fork (struct thread *parent);
+void page_destroy (void);
 uint32_t spt_hash_func(struct hash_elem *e);
 bool spt_hash_less_func (const struct hash_elem *elem_a, const struct hash_elem *elem_b, void *aux);
 
@@ -0,0 +1,326 @@
+#include "vm/share.h"
+#include <hash.h>
+#include <string.h>
+#include "vm/frame.h"
+#include "vm/swap.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+#include "filesys/file.h"
+
+bool install_page (void *upage, void *kpage, bool writable);
+
+/* A page in memory mapped by more than one process.  Either a
+   read-only executable page, shared by every process that maps
+   the same page of the same file, or an anonymous page shared
+   copy-on-write by fork().  Executable pages are keyed by inode
+   rather than by struct file, since each process opens its
+   executable separately; copy-on-write pages have no key. */
+struct shared_page
+{
+    struct inode *inode;        /* NULL for copy-on-write pages. */
+    off_t ofs;
+    size_t read_bytes;
+
+    void *kpage;
+    int refcnt;                 /* Number of frame table entries. */
+    struct hash_elem elem;
+};
+
+/* The zero page: a copy-on-write page of zeros that untouched
+   zero-fill pages map until they are first written.  It holds a
+   reference of its own, so it is never freed. */
+static struct shared_page *zero_page;
+
+/* Shared executable pages by (inode, ofs, read_bytes).  Protected by
+   share_lock, which also protects refcnt. */
+static struct hash shared_pages;
+static struct lock share_lock;
+
+static unsigned shared_page_hash (const struct hash_elem *, void *);
+static bool shared_page_less (const struct hash_elem *,
+                              const struct hash_elem *, void *);
+static struct shared_page *shared_page_get (struct sup_page_table_entry *);
+
+/*
+ * Initialize the shared page table.
+ */
+void
+share_init (void)
+{
+    hash_init(&shared_pages, shared_page_hash, shared_page_less, NULL);
+    lock_init(&share_lock);
+
+    zero_page = share_new_cow(palloc_get_page(PAL_ASSERT | PAL_ZERO));
+    if (zero_page == NULL)
+        PANIC ("share_init: cannot allocate the zero page");
+}
+
+/*
+ * Pages loaded from an executable that are never written are
+ * shared between processes.
+ */
+bool
+share_is_shareable (const struct sup_page_table_entry *spte)
+{
+    return spte->from_load && !spte->writable && spte->file != NULL
+           && spte->page_read_bytes != 0;
+}
+
+/*
+ * Is SPTE a zero-fill page, other than a file mapping, that has
+ * not been loaded?  Such a page can map the zero page until it is
+ * written.
+ */
+bool
+share_is_zero_fill (const struct sup_page_table_entry *spte)
+{
+    return !spte->is_mapped && spte->page_read_bytes == 0
+           && (spte->from_load || spte->file == NULL);
+}
+
+/*
+ * Map SPTE's page, which must be zero-fill, read-only to the zero
+ * page.  The first write to it faults into frame_cow_break(),
+ * which gives it a private frame.  Returns false if out of
+ * memory.
+ */
+bool
+share_zero_in (struct sup_page_table_entry *spte)
+{
+    ASSERT (share_is_zero_fill(spte));
+
+    share_get(zero_page);
+    if (!install_page(spte->user_vaddr, zero_page->kpage, false))
+    {
+        share_put(zero_page);
+        return false;
+    }
+    spte->frame = zero_page->kpage;
+    spte->is_in_frame = 1;
+    if (allocate_shared_frame(zero_page->kpage, spte, zero_page) == NULL)
+    {
+        pagedir_clear_page(thread_current()->pagedir, spte->user_vaddr);
+        spte->is_in_frame = 0;
+        share_put(zero_page);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Is SP the zero page?
+ */
+bool
+share_is_zero (const struct shared_page *sp)
+{
+    return sp == zero_page;
+}
+
+/*
+ * Map SPTE's page, which must be shareable, read-only from the
+ * shared page for it, loading the page first if no process has
+ * it in memory.  If EVICT is false, a page that has to be loaded
+ * is only loaded into a free frame.  Returns false if the page
+ * could not be mapped.
+ */
+bool
+share_page_in (struct sup_page_table_entry *spte, bool evict)
+{
+    ASSERT (share_is_shareable(spte));
+
+    struct shared_page *sp = shared_page_get(spte);
+    if (sp == NULL)
+    {
+        void *kpage = palloc_get_page(PAL_USER);
+        while (kpage == NULL && evict && swap_out())
+            kpage = palloc_get_page(PAL_USER);
+        if (kpage == NULL)
+            return false;
+        if (file_read_at(spte->file, kpage, spte->page_read_bytes, spte->ofs)
+            != (int) spte->page_read_bytes)
+        {
+            palloc_free_page(kpage);
+            return false;
+        }
+        memset(kpage + spte->page_read_bytes, 0, spte->page_zero_bytes);
+
+        struct shared_page *new_sp = malloc(sizeof *new_sp);
+        if (new_sp == NULL)
+        {
+            palloc_free_page(kpage);
+            return false;
+        }
+        new_sp->inode = file_get_inode(spte->file);
+        new_sp->ofs = spte->ofs;
+        new_sp->read_bytes = spte->page_read_bytes;
+        new_sp->kpage = kpage;
+        new_sp->refcnt = 1;
+
+        /* Another process may have loaded it meanwhile. */
+        lock_acquire(&share_lock);
+        struct hash_elem *e = hash_insert(&shared_pages, &new_sp->elem);
+        if (e != NULL)
+        {
+            sp = hash_entry(e, struct shared_page, elem);
+            sp->refcnt++;
+        }
+        lock_release(&share_lock);
+        if (e != NULL)
+        {
+            palloc_free_page(kpage);
+            free(new_sp);
+        }
+        else
+            sp = new_sp;
+    }
+
+    /* Map it before the frame table can see it, so that it cannot
+       be evicted half set up. */
+    if (!install_page(spte->user_vaddr, sp->kpage, false))
+    {
+        share_put(sp);
+        return false;
+    }
+    spte->frame = sp->kpage;
+    spte->is_in_frame = 1;
+    if (allocate_shared_frame(sp->kpage, spte, sp) == NULL)
+    {
+        pagedir_clear_page(thread_current()->pagedir, spte->user_vaddr);
+        spte->is_in_frame = 0;
+        share_put(sp);
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Make a copy-on-write shared page out of private page KPAGE,
+ * with one reference.  Returns NULL if out of memory.
+ */
+struct shared_page *
+share_new_cow (void *kpage)
+{
+    struct shared_page *sp = malloc(sizeof *sp);
+    if (sp == NULL)
+        return NULL;
+    sp->inode = NULL;
+    sp->ofs = 0;
+    sp->read_bytes = 0;
+    sp->kpage = kpage;
+    sp->refcnt = 1;
+    return sp;
+}
+
+/*
+ * Is SP a read-only executable page, as opposed to a
+ * copy-on-write one?
+ */
+bool
+share_is_text (const struct shared_page *sp)
+{
+    return sp->inode != NULL;
+}
+
+/*
+ * Take another reference to SP.
+ */
+void
+share_get (struct shared_page *sp)
+{
+    lock_acquire(&share_lock);
+    sp->refcnt++;
+    lock_release(&share_lock);
+}
+
+/*
+ * If the caller holds the only reference to copy-on-write page
+ * SP, free SP and return its page, which is then the caller's.
+ * Otherwise return NULL.  References to a copy-on-write page are
+ * only added by fork(), under frame_table_lock, so the caller
+ * must hold that lock.
+ */
+void *
+share_take (struct shared_page *sp)
+{
+    void *kpage = NULL;
+
+    ASSERT (!share_is_text(sp));
+    lock_acquire(&share_lock);
+    if (sp->refcnt == 1)
+        kpage = sp->kpage;
+    lock_release(&share_lock);
+
+    if (kpage != NULL)
+        free(sp);
+    return kpage;
+}
+
+/*
+ * Drop a reference to SP, freeing its page with the last one.
+ * The caller must have unmapped it.
+ */
+void
+share_put (struct shared_page *sp)
+{
+    bool last;
+
+    lock_acquire(&share_lock);
+    last = --sp->refcnt == 0;
+    if (last && share_is_text(sp))
+        hash_delete(&shared_pages, &sp->elem);
+    lock_release(&share_lock);
+
+    if (last)
+    {
+        palloc_free_page(sp->kpage);
+        free(sp);
+    }
+}
+
+/* Returns the shared page for SPTE with a new reference, or NULL
+   if it is not in memory. */
+static struct shared_page *
+shared_page_get (struct sup_page_table_entry *spte)
+{
+    struct shared_page key, *sp = NULL;
+    struct hash_elem *e;
+
+    key.inode = file_get_inode(spte->file);
+    key.ofs = spte->ofs;
+    key.read_bytes = spte->page_read_bytes;
+
+    lock_acquire(&share_lock);
+    e = hash_find(&shared_pages, &key.elem);
+    if (e != NULL)
+    {
+        sp = hash_entry(e, struct shared_page, elem);
+        sp->refcnt++;
+    }
+    lock_release(&share_lock);
+    return sp;
+}
+
+static unsigned
+shared_page_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+    const struct shared_page *sp = hash_entry(e, struct shared_page, elem);
+    return hash_bytes(&sp->inode, sizeof sp->inode) ^ hash_int(sp->ofs);
+}
+
+static bool
+shared_page_less (const struct hash_elem *a_, const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+    const struct shared_page *a = hash_entry(a_, struct shared_page, elem);
+    const struct shared_page *b = hash_entry(b_, struct shared_page, elem);
+
+    if (a->inode != b->inode)
+        return a->inode < b->inode;
+    if (a->ofs != b->ofs)
+        return a->ofs < b->ofs;
+    return a->read_bytes < b->read_bytes;
+}
@@ -0,0 +1,21 @@
+#include <stdbool.h>
+#include "vm/page.h"
+
+#ifndef VM_SHARE_H
+#define VM_SHARE_H
+
+struct shared_page;
+
+void share_init (void);
+bool share_is_shareable (const struct sup_page_table_entry *spte);
+bool share_page_in (struct sup_page_table_entry *spte, bool evict);
+bool share_is_zero_fill (const struct sup_page_table_entry *spte);
+bool share_zero_in (struct sup_page_table_entry *spte);
+bool share_is_zero (const struct shared_page *);
+struct shared_page *share_new_cow (void *kpage);
+bool share_is_text (const struct shared_page *);
+void share_get (struct shared_page *);
+void *share_take (struct shared_page *);
+void share_put (struct shared_page *);
+
+#endif /* vm/share.h */
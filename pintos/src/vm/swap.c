@@ -4,9 +4,19 @@
 #include "threads/synch.h"
 #include <bitmap.h>
 #include "vm/frame.h"
+#include "vm/share.h"
+#include "vm/zswap.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"
 #include "threads/vaddr.h"
+#include "filesys/file.h"
+#include "threads/palloc.h"
+#include <string.h>
+
+/* Swap slots are handed out in clusters of SWAP_CLUSTER
+   consecutive slots, and swap_in() reads up to SWAP_CLUSTER
+   slots with one disk command. */
+#define SWAP_CLUSTER 8
 
 /* The swap device */
 static struct disk *swap_device;
@@ -14,9 +24,26 @@ static struct disk *swap_device;
 /* Tracks in-use and free swap slots */
 static struct bitmap *swap_table;
 
-/* Protects swap_table */
+/* Protects swap_table and the swapping_out flags of pages.
+   Never held across disk or file I/O, so that swap traffic on
+   hd1:1 and file system traffic on hd0:1 can overlap. */
 struct lock swap_lock;
 
+/* Broadcast when a swap_out() write finishes. */
+static struct condition swap_io_done;
+
+/* Next slot of the cluster swap_out() is filling, so that pages
+   evicted one after another land in consecutive slots.
+   Protected by swap_lock. */
+static size_t swap_cursor;
+
+/* Buffer for swap_in() read-around, SWAP_CLUSTER pages. */
+static uint8_t *readaround_buf;
+static struct lock readaround_lock;
+
+static size_t swap_slot_alloc (void);
+static size_t swap_readaround (struct sup_page_table_entry *, void *kpage);
+
 //
 // extern struct hash frame_table;
 
@@ -36,6 +63,38 @@ swap_init (void)
         return;
 
     lock_init(&swap_lock);
+    cond_init(&swap_io_done);
+    swap_cursor = BITMAP_ERROR;
+    readaround_buf = palloc_get_multiple(PAL_ASSERT, SWAP_CLUSTER);
+    lock_init(&readaround_lock);
+    zswap_init();
+}
+
+/*
+ * Take a free swap slot, continuing the current cluster if its
+ * next slot is free and starting a new one otherwise.  Returns
+ * BITMAP_ERROR if swap is full.
+ */
+static size_t
+swap_slot_alloc (void)
+{
+    size_t slot;
+
+    ASSERT (lock_held_by_current_thread(&swap_lock));
+    if (swap_cursor != BITMAP_ERROR && swap_cursor < bitmap_size(swap_table)
+        && !bitmap_test(swap_table, swap_cursor))
+        slot = swap_cursor;
+    else
+    {
+        slot = bitmap_scan(swap_table, 0, SWAP_CLUSTER, false);
+        if (slot == BITMAP_ERROR)
+            slot = bitmap_scan(swap_table, 0, 1, false);
+        if (slot == BITMAP_ERROR)
+            return BITMAP_ERROR;
+    }
+    bitmap_mark(swap_table, slot);
+    swap_cursor = slot + 1;
+    return slot;
 }
 
 /*
@@ -54,60 +113,54 @@ bool
 swap_in (void *addr, void *kpage)
 {   
     lock_acquire(&swap_lock);
-    struct thread *curr = thread_current();
-    struct hash_iterator i;
-    struct sup_page_table_entry *spte; 
-    hash_first (&i, &curr->spt);
-
-    while (hash_next (&i)) //find spte
-    {
-        spte = hash_entry (hash_cur (&i), struct sup_page_table_entry, hash_elem);
-        if(spte->user_vaddr == addr)
-            break;
-    }
+    struct sup_page_table_entry *spte = spte_find(addr);
 
     if(spte == NULL){
         lock_release(&swap_lock);
         return false;
     }
+
+    /* Let a write of this page that is still in flight finish
+       before reading it back. */
+    while (spte->swapping_out)
+        cond_wait(&swap_io_done, &swap_lock);
         
     if(spte->is_in_frame){
         lock_release(&swap_lock);
         return false;
     }
         
-    if (spte->is_mapped) {
+    if (spte->is_mapped && spte->is_in_swap && spte->is_in_zswap) {
+        size_t index = spte->bit_index;
+        spte->is_in_zswap = 0;
+        lock_release(&swap_lock);
+
+        zswap_load(kpage, index);
+        zswap_free(index);
+    }
+    else if (spte->is_mapped && spte->is_in_swap) {
         size_t bit_index = spte->bit_index;
+        lock_release(&swap_lock);
         
         // swap에도 없는 경우
-        read_from_disk(kpage, bit_index); //kpage의 정보를 bit_index에 read
-        bitmap_flip(swap_table, bit_index); //flip
+        if (swap_readaround(spte, kpage) == 1)
+            read_from_disk(kpage, bit_index); //kpage의 정보를 bit_index에 read
 
-        spte->frame = kpage;
-        spte->is_in_frame = 1;
+        lock_acquire(&swap_lock);
+        bitmap_flip(swap_table, bit_index); //flip
+        lock_release(&swap_lock);
     }
     else
     {
+        lock_release(&swap_lock);
         file_seek(spte->file, spte->ofs);
         file_read(spte->file, kpage, spte->page_read_bytes);
         memset (kpage + spte->page_read_bytes, 0, spte->page_zero_bytes);
     }
 
-    struct frame_table_entry *fte = allocate_frame(kpage, spte);
-    if(!fte){
-        palloc_free_page(kpage);
-        free(fte);
-        lock_release(&swap_lock);
-        return false;
-    }
-    
-    if(!install_page(addr, kpage, spte->writable)){
-        palloc_free_page(kpage);
-        lock_release(&swap_lock);
-        return false;
-    }
-    lock_release(&swap_lock);
-    return true;
+    /* Map it before the frame table can see it.  On failure KPAGE
+       is left to the caller. */
+    return frame_install(spte, kpage, spte->writable);
 }
 
 /* 
@@ -123,55 +176,253 @@ swap_in (void *addr, void *kpage)
  * them. 
  * 4. Find a free block to write you data. Use swap table to get track
  * of in-use and free swap slots.
+ *
+ * The page is marked as on its way out before it is unmapped, so
+ * that an owner faulting on it waits for the write instead of
+ * finding it still "in a frame".  It is unmapped before it is
+ * written, so its owner cannot change it under the write, and
+ * swap_lock is dropped for the write itself.  Returns false if
+ * there was no frame to evict.
  */
 bool
 swap_out (void)
 {
-    lock_acquire(&swap_lock);
     struct list_elem *evicted_elem = delete_frame_entry();
+    if (evicted_elem == NULL)
+        return false;
     struct frame_table_entry *evicted_fte = list_entry(evicted_elem, struct frame_table_entry, elem);
     struct sup_page_table_entry *evicted_spte = evicted_fte->spte;
+    uint32_t *pd = evicted_fte->owner->pagedir;
+    bool dropped = evicted_fte->shared != NULL
+        && (share_is_text(evicted_fte->shared) || share_is_zero(evicted_fte->shared));
+    bool dirty;
+
+    lock_acquire(&swap_lock);
+    evicted_spte->swapping_out = 1;
+    evicted_spte->is_in_frame = 0;
+    if (dropped)
+        evicted_spte->is_mapped = 0;
+    lock_release(&swap_lock);
+
+    /* Read the dirty bit only once the page is unmapped, so that
+       no write can slip in after it. */
+    pagedir_clear_page(pd, evicted_spte->user_vaddr);
+    dirty = pagedir_is_dirty(pd, evicted_spte->user_vaddr);
+
+    /* A shared text page is never dirty: drop this process's
+       mapping, and the page with the last one.  The page faults
+       back in through the shared page table, and a page mapping
+       the zero page faults back in to the zero page.  A
+       copy-on-write page is written to swap for this process like
+       any other, and the frame only freed with its last mapping. */
+    if (dropped)
+    {
+        lock_acquire(&swap_lock);
+        evicted_spte->swapping_out = 0;
+        cond_broadcast(&swap_io_done, &swap_lock);
+        lock_release(&swap_lock);
+        share_put(evicted_fte->shared);
+        free(evicted_fte);
+        return true;
+    }
 
     if(evicted_spte->is_in_swap)
     {
-        size_t bit_index = bitmap_scan(swap_table, 0, 1, 0);
-        bitmap_flip(swap_table, bit_index);
-        write_to_disk(evicted_fte->frame, bit_index);
+        /* Try the compressed swap cache first, and spill to disk
+           if the page does not compress or the arena is full. */
+        size_t index = zswap_store(evicted_fte->frame);
+        lock_acquire(&swap_lock);
+        if (index != BITMAP_ERROR)
+        {
+            evicted_spte->bit_index = index;
+            evicted_spte->is_in_zswap = 1;
+            lock_release(&swap_lock);
+        }
+        else
+        {
+            size_t bit_index = swap_slot_alloc();
+            if (bit_index == BITMAP_ERROR)
+                PANIC ("swap_out: out of swap slots");
+            evicted_spte->bit_index = bit_index;
+            evicted_spte->is_in_zswap = 0;
+            lock_release(&swap_lock);
 
-        evicted_spte->bit_index = bit_index;
+            write_to_disk(evicted_fte->frame, bit_index);
+        }
     }
     else
     {
-        if (pagedir_is_dirty(thread_current()->pagedir, evicted_spte->user_vaddr))
+        if (dirty)
         {
-            file_seek(evicted_spte->file, evicted_spte->ofs);
-            file_write(evicted_spte->file, evicted_spte->frame, evicted_spte->page_read_bytes);
+            file_write_at(evicted_spte->file, evicted_fte->frame, evicted_spte->page_read_bytes, evicted_spte->ofs);
         }
     }
-    evicted_spte->is_in_frame = 0;
 
-    pagedir_clear_page(evicted_fte->owner->pagedir, evicted_spte->user_vaddr);
-    palloc_free_page(evicted_fte->frame);
+    lock_acquire(&swap_lock);
+    evicted_spte->swapping_out = 0;
+    cond_broadcast(&swap_io_done, &swap_lock);
+    lock_release(&swap_lock);
+
+    if (evicted_fte->shared != NULL)
+        share_put(evicted_fte->shared);
+    else
+        palloc_free_page(evicted_fte->frame);
     free(evicted_fte); //
+    return true;
+}
+
+/*
+ * Read-around for swapping in SPTE, a page of the current
+ * process that is in swap.  The pages right after it whose slots
+ * directly follow its slot are read together with it in one disk
+ * command, and as many of them as there are free user frames for
+ * are mapped in.  Copies SPTE's own page to KPAGE and returns the
+ * number of pages read, or returns 1 without reading anything if
+ * no neighbour qualifies.
+ */
+static size_t
+swap_readaround (struct sup_page_table_entry *spte, void *kpage)
+{
+    uint8_t *upage = (uint8_t *) spte->user_vaddr;
+    size_t slot = spte->bit_index;
+    struct sup_page_table_entry *next[SWAP_CLUSTER];
+    size_t cnt, i;
+
+    lock_acquire(&swap_lock);
+    for (cnt = 1; cnt < SWAP_CLUSTER; cnt++)
+    {
+        struct sup_page_table_entry *n = spte_find(upage + cnt * PGSIZE);
+        if (n == NULL || !n->is_mapped || !n->is_in_swap || n->is_in_frame
+            || n->swapping_out || n->is_in_zswap || n->bit_index != slot + cnt)
+            break;
+        next[cnt] = n;
+    }
     lock_release(&swap_lock);
+    if (cnt == 1)
+        return 1;
+
+    lock_acquire(&readaround_lock);
+    disk_read_multiple(swap_device, (disk_sector_t)(slot*8), readaround_buf, cnt*8);
+    memcpy(kpage, readaround_buf, PGSIZE);
+    for (i = 1; i < cnt; i++)
+    {
+        struct sup_page_table_entry *n = next[i];
+        void *kp = palloc_get_page(PAL_USER);
+        if (kp == NULL)
+            break;
+        memcpy(kp, readaround_buf + i * PGSIZE, PGSIZE);
+        /* Map it before the frame table can see it, as swap_in()
+           does.  The slot is given up only once that worked. */
+        if (!frame_install(n, kp, n->writable))
+        {
+            palloc_free_page(kp);
+            break;
+        }
+        lock_acquire(&swap_lock);
+        bitmap_reset(swap_table, n->bit_index);
+        lock_release(&swap_lock);
+    }
+    lock_release(&readaround_lock);
+    return cnt;
+}
+
+/*
+ * Give C, the running thread's fresh copy of PARENT's page P
+ * made by fork(), its own copy of P's swap slot if P is in swap.
+ * Leaves C alone if P is in a frame.  Returns false if swap is
+ * full.
+ */
+bool
+swap_fork (struct sup_page_table_entry *p, struct sup_page_table_entry *c)
+{
+    lock_acquire(&swap_lock);
+    while (p->swapping_out)
+        cond_wait(&swap_io_done, &swap_lock);
+    if (p->is_in_frame || !p->is_mapped || !p->is_in_swap)
+    {
+        lock_release(&swap_lock);
+        return true;
+    }
+    size_t slot = p->bit_index;
+    bool in_zswap = p->is_in_zswap;
+    lock_release(&swap_lock);
+
+    /* P cannot come back in under us: only its own process, which
+       is waiting for the fork, faults it in. */
+    if (in_zswap)
+    {
+        size_t index = zswap_dup(slot);
+        if (index != BITMAP_ERROR)
+        {
+            c->bit_index = index;
+            c->is_in_zswap = 1;
+            c->is_mapped = 1;
+            return true;
+        }
+    }
+
+    lock_acquire(&swap_lock);
+    size_t new_slot = swap_slot_alloc();
+    lock_release(&swap_lock);
+    if (new_slot == BITMAP_ERROR)
+        return false;
+
+    uint8_t *buf = palloc_get_page(0);
+    if (buf == NULL)
+    {
+        lock_acquire(&swap_lock);
+        bitmap_reset(swap_table, new_slot);
+        lock_release(&swap_lock);
+        return false;
+    }
+    if (in_zswap)
+        zswap_load(buf, slot);
+    else
+        read_from_disk(buf, slot);
+    write_to_disk(buf, new_slot);
+    palloc_free_page(buf);
+
+    c->bit_index = new_slot;
+    c->is_mapped = 1;
     return true;
 }
 
+/*
+ * Free SPTE, a page of the running thread's supplemental page
+ * table, on exit, with the swap slot or compressed swap entry
+ * holding it.  SPTE must not be in the frame table any more.  A
+ * page still on its way out of its frame is waited for first.
+ */
+void
+swap_free (struct sup_page_table_entry *spte)
+{
+    ASSERT (spte->fte == NULL);
+
+    lock_acquire(&swap_lock);
+    while (spte->swapping_out || (spte->is_in_frame && spte->fte == NULL))
+        cond_wait(&swap_io_done, &swap_lock);
+    if (spte->is_mapped && spte->is_in_swap && !spte->is_in_frame)
+    {
+        if (spte->is_in_zswap)
+            zswap_free(spte->bit_index);
+        else
+            bitmap_reset(swap_table, spte->bit_index);
+    }
+    lock_release(&swap_lock);
+    free(spte);
+}
+
 /* 
  * Read data from swap device to frame. 
  * Look at device/disk.c
  */
 void read_from_disk (uint8_t *frame, int index)
 {
-    int i=0;
-    for(i=0;i<8;i++)
-        disk_read(swap_device, (disk_sector_t)(index*8+i), frame+i*512);
+    disk_read_multiple(swap_device, (disk_sector_t)(index*8), frame, 8);
 }
 
 /* Write data to swap device from frame */
 void write_to_disk (uint8_t *frame, int index)
 {
-    int i=0;
-    for(i=0;i<8;i++)
-        disk_write(swap_device, (disk_sector_t)(index*8+i), frame+i*512);
+    disk_write_multiple(swap_device, (disk_sector_t)(index*8), frame, 8);
 }
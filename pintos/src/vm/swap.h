@@ -5,9 +5,13 @@
 #ifndef VM_SWAP_H
 #define VM_SWAP_H
 
+struct sup_page_table_entry;
+
 void swap_init (void);
 bool swap_in (void *addr, void *kpage);
 bool swap_out (void);
+bool swap_fork (struct sup_page_table_entry *p, struct sup_page_table_entry *c);
+void swap_free (struct sup_page_table_entry *spte);
 void read_from_disk (uint8_t *frame, int index);
 void write_to_disk (uint8_t *frame, int index);
 
@@ -0,0 +1,277 @@
+#include "vm/zswap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Compressed swap cache.  swap_out() offers each anonymous page
+   here before writing it to the swap disk.  Pages are compressed
+   with a small LZ77 compressor into an arena of kernel pages, cut
+   into ZSWAP_BLOCK-byte blocks, and a page that does not compress
+   to ZSWAP_MAX_LEN bytes, or does not fit in the arena, goes to
+   disk as before.  An entry is named by its first block. */
+
+#define ZSWAP_BLOCK 64                  /* Bytes per arena block. */
+#define ZSWAP_MAX_LEN (PGSIZE * 3 / 4)  /* Largest compressed page kept. */
+
+size_t zswap_pages = 64;
+
+static uint8_t *arena;
+static struct bitmap *arena_map;        /* Blocks in use. */
+static uint16_t *entry_len;             /* Compressed size, by first block. */
+static uint8_t *scratch;                /* One page of compressor output. */
+
+/* Protects arena_map, entry_len, scratch and lz_table. */
+static struct lock zswap_lock;
+
+/* LZ77 compressor, in the style of LZ4.  The output is a series
+   of sequences, each a token byte, literals and a match.  The
+   token's high nibble is the literal count and its low nibble the
+   match length minus LZ_MIN_MATCH; a nibble of 15 is continued in
+   following bytes, 255 at a time.  Literals are followed by a
+   2-byte little-endian match offset.  The last sequence has
+   literals only, and ends the page. */
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 10
+
+/* Page offsets of recently seen 4-byte strings, by hash. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static size_t lz_compress (const uint8_t *src, uint8_t *dst, size_t max);
+static void lz_decompress (const uint8_t *src, uint8_t *dst);
+
+/*
+ * Set up the arena.  The cache stays off if the kernel pool
+ * cannot spare zswap_pages pages.
+ */
+void
+zswap_init (void)
+{
+    size_t blocks = zswap_pages * PGSIZE / ZSWAP_BLOCK;
+
+    lock_init(&zswap_lock);
+    if (zswap_pages == 0)
+        return;
+
+    arena = palloc_get_multiple(0, zswap_pages);
+    arena_map = bitmap_create(blocks);
+    entry_len = malloc(blocks * sizeof *entry_len);
+    scratch = palloc_get_page(0);
+    if (arena == NULL || arena_map == NULL || entry_len == NULL || scratch == NULL)
+    {
+        if (arena != NULL)
+            palloc_free_multiple(arena, zswap_pages);
+        if (arena_map != NULL)
+            bitmap_destroy(arena_map);
+        free(entry_len);
+        if (scratch != NULL)
+            palloc_free_page(scratch);
+        arena = NULL;
+    }
+}
+
+/*
+ * Compress PAGE into the arena.  Returns the new entry, or
+ * BITMAP_ERROR if the page does not compress well enough or the
+ * arena is full.
+ */
+size_t
+zswap_store (const void *page)
+{
+    size_t len, index;
+
+    if (arena == NULL)
+        return BITMAP_ERROR;
+
+    lock_acquire(&zswap_lock);
+    len = lz_compress(page, scratch, ZSWAP_MAX_LEN);
+    index = BITMAP_ERROR;
+    if (len != 0)
+        index = bitmap_scan_and_flip(arena_map, 0, DIV_ROUND_UP(len, ZSWAP_BLOCK), false);
+    if (index != BITMAP_ERROR)
+    {
+        memcpy(arena + index * ZSWAP_BLOCK, scratch, len);
+        entry_len[index] = len;
+    }
+    lock_release(&zswap_lock);
+    return index;
+}
+
+/*
+ * Decompress entry INDEX into PAGE.  The entry is kept.
+ */
+void
+zswap_load (void *page, size_t index)
+{
+    /* Only the entry's owner reads or frees it, so its blocks
+       cannot change under us. */
+    lz_decompress(arena + index * ZSWAP_BLOCK, page);
+}
+
+/*
+ * Copy entry INDEX.  Returns the copy, or BITMAP_ERROR if the
+ * arena is full.
+ */
+size_t
+zswap_dup (size_t index)
+{
+    size_t len, copy;
+
+    lock_acquire(&zswap_lock);
+    len = entry_len[index];
+    copy = bitmap_scan_and_flip(arena_map, 0, DIV_ROUND_UP(len, ZSWAP_BLOCK), false);
+    if (copy != BITMAP_ERROR)
+    {
+        memcpy(arena + copy * ZSWAP_BLOCK, arena + index * ZSWAP_BLOCK, len);
+        entry_len[copy] = len;
+    }
+    lock_release(&zswap_lock);
+    return copy;
+}
+
+/*
+ * Free entry INDEX.
+ */
+void
+zswap_free (size_t index)
+{
+    lock_acquire(&zswap_lock);
+    bitmap_set_multiple(arena_map, index, DIV_ROUND_UP(entry_len[index], ZSWAP_BLOCK), false);
+    lock_release(&zswap_lock);
+}
+
+static uint32_t
+read32 (const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof v);
+    return v;
+}
+
+static unsigned
+lz_hash (uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the continuation of a length nibble of 15. */
+static uint8_t *
+lz_put_len (uint8_t *op, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = len;
+    return op;
+}
+
+/* Reads the continuation of a length nibble of 15. */
+static size_t
+lz_get_len (const uint8_t **ip)
+{
+    size_t len = 0;
+    uint8_t b;
+
+    do
+    {
+        b = *(*ip)++;
+        len += b;
+    }
+    while (b == 255);
+    return len;
+}
+
+/* Compresses the page at SRC into DST.  Returns the compressed
+   size, or 0 if it would be more than MAX bytes. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t max)
+{
+    const uint8_t *ip = src, *anchor = src, *end = src + PGSIZE;
+    uint8_t *op = dst, *op_end = dst + max;
+    size_t lit;
+
+    ASSERT (lock_held_by_current_thread(&zswap_lock));
+    memset(lz_table, 0, sizeof lz_table);
+    while (ip <= end - LZ_MIN_MATCH)
+    {
+        uint32_t v = read32(ip);
+        unsigned h = lz_hash(v);
+        const uint8_t *ref = src + lz_table[h];
+        const uint8_t *m, *r;
+        size_t mlen, off;
+
+        lz_table[h] = ip - src;
+        if (ref >= ip || read32(ref) != v)
+        {
+            ip++;
+            continue;
+        }
+
+        for (m = ip + LZ_MIN_MATCH, r = ref + LZ_MIN_MATCH; m < end && *m == *r; m++, r++)
+            continue;
+        lit = ip - anchor;
+        mlen = m - ip - LZ_MIN_MATCH;
+        off = ip - ref;
+        if (op + 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1 > op_end)
+            return 0;
+
+        *op++ = (lit < 15 ? lit : 15) << 4 | (mlen < 15 ? mlen : 15);
+        if (lit >= 15)
+            op = lz_put_len(op, lit - 15);
+        memcpy(op, anchor, lit);
+        op += lit;
+        *op++ = off & 0xff;
+        *op++ = off >> 8;
+        if (mlen >= 15)
+            op = lz_put_len(op, mlen - 15);
+        ip = anchor = m;
+    }
+
+    lit = end - anchor;
+    if (op + 1 + lit / 255 + 1 + lit > op_end)
+        return 0;
+    *op++ = (lit < 15 ? lit : 15) << 4;
+    if (lit >= 15)
+        op = lz_put_len(op, lit - 15);
+    memcpy(op, anchor, lit);
+    op += lit;
+    return op - dst;
+}
+
+/* Decompresses the page compressed at SRC into DST. */
+static void
+lz_decompress (const uint8_t *src, uint8_t *dst)
+{
+    const uint8_t *ip = src;
+    uint8_t *op = dst, *end = dst + PGSIZE;
+
+    for (;;)
+    {
+        unsigned token = *ip++;
+        size_t lit = token >> 4, mlen = token & 15, off;
+        const uint8_t *r;
+
+        if (lit == 15)
+            lit += lz_get_len(&ip);
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (op >= end)
+            break;
+
+        off = ip[0] | ip[1] << 8;
+        ip += 2;
+        if (mlen == 15)
+            mlen += lz_get_len(&ip);
+        mlen += LZ_MIN_MATCH;
+
+        /* Byte by byte: the match may overlap its own output. */
+        for (r = op - off; mlen > 0; mlen--)
+            *op++ = *r++;
+    }
+    ASSERT (op == end);
+}
@@ -0,0 +1,16 @@
+#include <stddef.h>
+
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+
+/* Kernel pages given to the compressed swap cache.  Set with
+   -zs; 0 turns it off. */
+extern size_t zswap_pages;
+
+void zswap_init (void);
+size_t zswap_store (const void *page);
+void zswap_load (void *page, size_t index);
+size_t zswap_dup (size_t index);
+void zswap_free (size_t index);
+
+#endif /* vm/zswap.h */